@@ -0,0 +1,89 @@
+#include <blpl/Batch.h>
+#include <blpl/BatchFilter.h>
+#include <blpl/FunctorFilter.h>
+
+#include <benchmark/benchmark.h>
+
+using namespace blpl;
+
+namespace {
+
+constexpr size_t numElements = 1 << 16;
+
+float saxpy(float x, float y)
+{
+    return 2.5f * x + y;
+}
+
+/**
+ * @brief One element per call to process, like a Filter<float, float>.
+ */
+void scalarFilter(benchmark::State& state)
+{
+    auto filter = makeFunctorFilter<float>(
+        [](float&& x) { return saxpy(x, 1.f); });
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < numElements; ++i) {
+            float out = filter.process(static_cast<float>(i));
+            benchmark::DoNotOptimize(out);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(numElements));
+}
+BENCHMARK(scalarFilter);
+
+template <size_t BatchSize>
+void batchFilter(benchmark::State& state)
+{
+    using InBatch = Batch<BatchSize, float, float>;
+    auto filter   = makeBatchFilter<InBatch>(saxpy);
+
+    InBatch batch;
+    for (size_t i = 0; i < BatchSize; ++i)
+        batch.push(static_cast<float>(i), 1.f);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < numElements; i += BatchSize) {
+            auto out = filter.process(InBatch(batch));
+            benchmark::DoNotOptimize(out.template column<0>());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(numElements));
+}
+BENCHMARK_TEMPLATE(batchFilter, 1);
+BENCHMARK_TEMPLATE(batchFilter, 16);
+BENCHMARK_TEMPLATE(batchFilter, 256);
+BENCHMARK_TEMPLATE(batchFilter, 4096);
+
+template <size_t BatchSize>
+void inPlaceBatchFilter(benchmark::State& state)
+{
+    using FloatBatch = Batch<BatchSize, float>;
+    auto filter      = makeBatchFilter<FloatBatch>(
+        [](float x) { return saxpy(x, 1.f); });
+
+    FloatBatch batch;
+    for (size_t i = 0; i < BatchSize; ++i)
+        batch.push(static_cast<float>(i));
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < numElements; i += BatchSize) {
+            batch = filter.process(std::move(batch));
+            benchmark::DoNotOptimize(batch.template column<0>());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(numElements));
+}
+BENCHMARK_TEMPLATE(inPlaceBatchFilter, 1);
+BENCHMARK_TEMPLATE(inPlaceBatchFilter, 16);
+BENCHMARK_TEMPLATE(inPlaceBatchFilter, 256);
+BENCHMARK_TEMPLATE(inPlaceBatchFilter, 4096);
+
+} // namespace
@@ -0,0 +1,79 @@
+#include <blpl/FunctorFilter.h>
+
+#include <functional>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace blpl;
+
+namespace {
+
+using Payload = std::vector<float>;
+
+Payload scale(Payload&& in)
+{
+    for (auto& value : in)
+        value *= 1.0001f;
+    return std::move(in);
+}
+
+/**
+ * @brief The FunctorFilter before it was templated on the functor: it stored a
+ * std::function taking the input by value and called it with an lvalue, so
+ * every call copied the payload.
+ */
+class CopyingFunctorFilter : public Filter<Payload, Payload>
+{
+public:
+    CopyingFunctorFilter(std::function<Payload(Payload&&)> filterFunc)
+        : m_filterFunc(filterFunc)
+    {}
+
+protected:
+    Payload processImpl(Payload&& in) override
+    {
+        return m_filterFunc(in);
+    }
+
+private:
+    std::function<Payload(Payload)> m_filterFunc;
+};
+
+template <class FilterType>
+void runFilter(benchmark::State& state, FilterType& filter)
+{
+    Payload data(static_cast<size_t>(state.range(0)), 1.f);
+
+    for (auto _ : state) {
+        data = filter.process(std::move(data));
+        benchmark::DoNotOptimize(data.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            static_cast<int64_t>(sizeof(float)));
+}
+
+void copyingFunctorFilter(benchmark::State& state)
+{
+    CopyingFunctorFilter filter(scale);
+    runFilter(state, filter);
+}
+BENCHMARK(copyingFunctorFilter)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+void stdFunctionFunctorFilter(benchmark::State& state)
+{
+    FunctorFilter<Payload, Payload> filter(scale);
+    runFilter(state, filter);
+}
+BENCHMARK(stdFunctionFunctorFilter)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+void lambdaFunctorFilter(benchmark::State& state)
+{
+    auto filter = makeFunctorFilter<Payload>(
+        [](Payload&& in) { return scale(std::move(in)); });
+    runFilter(state, filter);
+}
+BENCHMARK(lambdaFunctorFilter)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+} // namespace
@@ -0,0 +1,80 @@
+#include <blpl/Pipe.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace blpl;
+
+namespace {
+
+constexpr int numElements = 1 << 16;
+
+/**
+ * @brief Pushes numElements split over the producers into the pipe, while one
+ * consumer pops them.
+ */
+template <class PushFunc>
+void runProducers(Pipe<int>& pipe, int numProducers, PushFunc push)
+{
+    const int perProducer = numElements / numProducers;
+
+    std::vector<std::thread> producers;
+    producers.reserve(numProducers);
+    for (int p = 0; p < numProducers; ++p) {
+        producers.emplace_back([&push, perProducer] {
+            for (int i = 0; i < perProducer; ++i)
+                push(i);
+        });
+    }
+
+    long long sum = 0;
+    for (int popped = 0; popped < perProducer * numProducers;) {
+        if (auto elem = pipe.tryPop()) {
+            sum += *elem;
+            ++popped;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+
+    for (auto& producer : producers)
+        producer.join();
+}
+
+/**
+ * @brief The single slot pipe behind a mutex, as needed without a capacity.
+ */
+void mutexGuardedPipe(benchmark::State& state)
+{
+    auto numProducers = static_cast<int>(state.range(0));
+    Pipe<int> pipe(true);
+    std::mutex mutex;
+
+    for (auto _ : state) {
+        runProducers(pipe, numProducers, [&](int i) {
+            std::scoped_lock<std::mutex> lock(mutex);
+            pipe.push(int(i));
+        });
+    }
+
+    state.SetItemsProcessed(state.iterations() * numElements);
+}
+BENCHMARK(mutexGuardedPipe)->RangeMultiplier(2)->Range(2, 16)->UseRealTime();
+
+void queuedPipe(benchmark::State& state)
+{
+    auto numProducers = static_cast<int>(state.range(0));
+    Pipe<int> pipe(true, 1024);
+
+    for (auto _ : state)
+        runProducers(pipe, numProducers, [&](int i) { pipe.push(int(i)); });
+
+    state.SetItemsProcessed(state.iterations() * numElements);
+}
+BENCHMARK(queuedPipe)->RangeMultiplier(2)->Range(2, 16)->UseRealTime();
+
+} // namespace
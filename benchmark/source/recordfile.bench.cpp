@@ -0,0 +1,142 @@
+#include <blpl/MappedRecordSource.h>
+#include <blpl/RecordFileSink.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace blpl;
+
+namespace {
+
+constexpr size_t fileSize = 64 << 20;
+
+std::string tempFile(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("blpl_bench_" + name))
+        .string();
+}
+
+/**
+ * @brief Makes sure the input file exists and returns its path.
+ */
+const std::string& inputFile()
+{
+    static std::string path = [] {
+        auto path = tempFile("records.bin");
+        std::ofstream file(path, std::ios::binary);
+        std::vector<char> chunk(1 << 20);
+        for (size_t i = 0; i < chunk.size(); ++i)
+            chunk[i] = static_cast<char>(i);
+        for (size_t i = 0; i < fileSize / chunk.size(); ++i)
+            file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        return path;
+    }();
+    return path;
+}
+
+uint64_t checksum(const std::byte* data, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i += 64)
+        sum += static_cast<uint64_t>(data[i]);
+    return sum;
+}
+
+void mappedRecordSource(benchmark::State& state)
+{
+    auto recordSize = static_cast<size_t>(state.range(0));
+    MappedRecordSource source(inputFile(), recordSize);
+
+    for (auto _ : state) {
+        source.reset();
+        uint64_t sum = 0;
+        while (!source.atEnd()) {
+            auto record = source.process(Generator());
+            sum += checksum(record.data(), record.size());
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(fileSize));
+}
+BENCHMARK(mappedRecordSource)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+/**
+ * @brief What a hand-rolled source does: read every record into a fresh buffer.
+ */
+void ifstreamRecordSource(benchmark::State& state)
+{
+    auto recordSize = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        std::ifstream file(inputFile(), std::ios::binary);
+        uint64_t sum = 0;
+        while (true) {
+            std::vector<std::byte> record(recordSize);
+            if (!file.read(reinterpret_cast<char*>(record.data()),
+                           static_cast<std::streamsize>(recordSize)))
+                break;
+            sum += checksum(record.data(), record.size());
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(fileSize));
+}
+BENCHMARK(ifstreamRecordSource)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+template <RecordFileSink::Mode mode>
+void recordFileSink(benchmark::State& state)
+{
+    auto recordSize = static_cast<size_t>(state.range(0));
+    std::vector<std::byte> record(recordSize);
+    auto path = tempFile("sink.bin");
+
+    for (auto _ : state) {
+        RecordFileSink sink(path, false, mode);
+        for (size_t written = 0; written < fileSize; written += recordSize)
+            sink.process(RecordView(record.data(), record.size()));
+    }
+
+    std::filesystem::remove(path);
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(fileSize));
+}
+void bufferedRecordFileSink(benchmark::State& state)
+{
+    recordFileSink<RecordFileSink::Mode::Buffered>(state);
+}
+BENCHMARK(bufferedRecordFileSink)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void directRecordFileSink(benchmark::State& state)
+{
+    recordFileSink<RecordFileSink::Mode::Direct>(state);
+}
+BENCHMARK(directRecordFileSink)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void ofstreamRecordSink(benchmark::State& state)
+{
+    auto recordSize = static_cast<size_t>(state.range(0));
+    std::vector<char> record(recordSize);
+    auto path = tempFile("sink.bin");
+
+    for (auto _ : state) {
+        std::ofstream file(path, std::ios::binary);
+        for (size_t written = 0; written < fileSize; written += recordSize)
+            file.write(record.data(), static_cast<std::streamsize>(recordSize));
+    }
+
+    std::filesystem::remove(path);
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(fileSize));
+}
+BENCHMARK(ofstreamRecordSink)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+} // namespace
@@ -0,0 +1,68 @@
+#include <blpl/MultiFilter.h>
+#include <blpl/ReducingMultiFilter.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace blpl;
+
+namespace {
+
+using Histogram = std::vector<float>;
+
+constexpr size_t histogramSize = 1 << 16;
+
+class HistogramFilter : public Filter<int, Histogram>
+{
+public:
+    Histogram processImpl(int&& in) override
+    {
+        return Histogram(histogramSize, static_cast<float>(in));
+    }
+};
+
+Histogram merge(Histogram&& a, Histogram&& b)
+{
+    for (size_t i = 0; i < a.size(); ++i)
+        a[i] += b[i];
+    return std::move(a);
+}
+
+MultiFilter<int, Histogram> makeLanes(size_t numLanes)
+{
+    std::vector<std::shared_ptr<HistogramFilter>> filters;
+    for (size_t i = 0; i < numLanes; ++i)
+        filters.push_back(std::make_shared<HistogramFilter>());
+    return MultiFilter<int, Histogram>(filters);
+}
+
+void sequentialReduction(benchmark::State& state)
+{
+    auto numLanes = static_cast<size_t>(state.range(0));
+    auto lanes    = makeLanes(numLanes);
+
+    for (auto _ : state) {
+        auto results     = lanes.process(std::vector<int>(numLanes, 1));
+        Histogram result = std::move(results[0]);
+        for (size_t i = 1; i < results.size(); ++i)
+            result = merge(std::move(result), std::move(results[i]));
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(sequentialReduction)->RangeMultiplier(4)->Range(4, 64);
+
+void treeReduction(benchmark::State& state)
+{
+    auto numLanes = static_cast<size_t>(state.range(0));
+    auto filter   = makeReducingMultiFilter(makeLanes(numLanes), merge);
+
+    for (auto _ : state) {
+        auto result = filter.process(std::vector<int>(numLanes, 1));
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(treeReduction)->RangeMultiplier(4)->Range(4, 64);
+
+} // namespace
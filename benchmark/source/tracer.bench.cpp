@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+
+#include "blpl/Tracer.h"
+
+using namespace blpl;
+
+namespace {
+
+void disabledTraceScope(benchmark::State& state)
+{
+    Tracer::disable();
+    for (auto _ : state) {
+        TraceScope scope("bench", "disabled");
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(disabledTraceScope);
+
+void enabledTraceScope(benchmark::State& state)
+{
+    Tracer::enable();
+    for (auto _ : state) {
+        TraceScope scope("bench", "enabled");
+        benchmark::ClobberMemory();
+    }
+    Tracer::disable();
+    Tracer::clear();
+}
+BENCHMARK(enabledTraceScope);
+
+} // namespace
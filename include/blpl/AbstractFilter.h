@@ -4,12 +4,17 @@
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 
 namespace blpl {
 
 /**
  * @brief Provides a way to inject introspecting code into a Filter without
  * changing the actual filter.
+ *
+ * The callbacks get a copy of the data, payloads that are not copyable are
+ * passed as an empty std::any.
  */
 class AbstractFilterListener
 {
@@ -34,6 +39,25 @@ public:
      */
     virtual void reset() {}
 
+    /**
+     * @brief When implemented, this method should append the state of the
+     * filter to out and return true, so that restore() can bring another
+     * instance of the filter into the same state, e.g. after a restart of the
+     * program. Filters without state don't have to implement it.
+     */
+    virtual bool snapshot(std::string& /*out*/) const
+    {
+        return false;
+    }
+    /**
+     * @brief Counterpart of snapshot(), restores the state it wrote. Returns
+     * false if the state can't be restored.
+     */
+    virtual bool restore(std::string_view /*state*/)
+    {
+        return false;
+    }
+
     /**
      * @brief Set a listener for this filter.
      */
@@ -1,5 +1,14 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "AbstractFilter.h"
+#include "FilterError.h"
+#include "FilterMetrics.h"
+
 namespace blpl {
 
 class AbstractFilterThread
@@ -9,6 +18,80 @@ public:
     virtual void start()            = 0;
     virtual void stop()             = 0;
     virtual void reset()            = 0;
+
+    /**
+     * @brief Returns the metrics of the filter collected since construction or
+     * the last call to resetMetrics(), if the thread collects any.
+     */
+    [[nodiscard]] virtual FilterMetrics metrics() const noexcept
+    {
+        return {};
+    }
+    virtual void resetMetrics() noexcept {}
+
+    /**
+     * @brief Replaces the filter while the thread keeps running. Returns false
+     * if the filter has the wrong type or the thread doesn't support it.
+     */
+    virtual bool replaceFilter(std::shared_ptr<AbstractFilter>) noexcept
+    {
+        return false;
+    }
+
+    /**
+     * @brief Keeps the thread from taking further elements from its in pipe
+     * and waits until the element in process was handed on. Returns false if
+     * the thread doesn't support pausing.
+     */
+    virtual bool pause() noexcept
+    {
+        return false;
+    }
+    /**
+     * @brief Lets a paused thread take elements again.
+     */
+    virtual void resume() noexcept {}
+
+    /**
+     * @brief Returns when the filter started processing the element it is
+     * working on, nothing if it is idle or the thread doesn't keep track.
+     */
+    [[nodiscard]] virtual std::optional<std::chrono::steady_clock::time_point>
+    processingSince() const noexcept
+    {
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Sets the function that receives exceptions thrown while handling
+     * an element, which is dropped. Without one the errors are only counted.
+     * Returns false if the thread doesn't catch exceptions.
+     */
+    virtual bool
+    setErrorHandler(std::function<void(FilterError&&)> /*handler*/) noexcept
+    {
+        return false;
+    }
+
+    /**
+     * @brief Lets the thread only run while results are requested from its
+     * out pipe, asking its in pipe for input as needed, see
+     * AbstractPipe::request(). Returns false if the thread doesn't support
+     * pull mode. Only call it while the thread is stopped.
+     */
+    virtual bool setPullMode(bool /*pull*/) noexcept
+    {
+        return false;
+    }
+    /**
+     * @brief Keeps a copy of the last result, which answers requests in pull
+     * mode while there is no new input. Returns false if the thread doesn't
+     * support caching, e.g. because the results can't be copied.
+     */
+    virtual bool setCaching(bool /*caching*/) noexcept
+    {
+        return false;
+    }
 };
 
 } // namespace blpl
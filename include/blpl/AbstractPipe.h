@@ -1,7 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "PriorityQueue.h"
 
 namespace blpl {
 
@@ -14,9 +22,15 @@ public:
         , m_enabled(true)
     {}
 
-    void reset() noexcept
+    virtual ~AbstractPipe() = default;
+
+    /**
+     * @brief Drops the element and the reset marker in the pipe, if any.
+     */
+    virtual void reset() noexcept
     {
         m_valid = false;
+        m_resetMarker.store(0, std::memory_order_relaxed);
     }
     void disable() noexcept
     {
@@ -31,9 +45,73 @@ public:
         m_waitForSlowestFilter = newValue;
     }
 
+    /**
+     * @brief Lets the pipe hold up to capacity elements, if it supports that.
+     * Must not be called while the pipe is in use.
+     *
+     * @return False if the pipe only ever holds a single element.
+     */
+    virtual bool setCapacity(size_t /*capacity*/) noexcept
+    {
+        return false;
+    }
+
+    /**
+     * @brief Gives the pipe a number of priority levels that hold up to
+     * capacity elements each, if it supports that. Less than two levels make it
+     * a single slot. Must not be called while the pipe is in use.
+     *
+     * @return False if the pipe only ever holds a single element.
+     */
+    virtual bool setPriorityLevels(size_t /*levels*/,
+                                   size_t /*capacity*/,
+                                   uint32_t /*starvationLimit*/) noexcept
+    {
+        return false;
+    }
+    /**
+     * @brief Returns the latencies per priority level, empty if the pipe has
+     * no priority levels.
+     */
+    [[nodiscard]] virtual std::vector<PriorityMetrics> priorityMetrics() const
+    {
+        return {};
+    }
+
+    /**
+     * @brief Accounts the payload bytes in the pipe to budget, or stops
+     * accounting for nullptr. Drops the elements in the pipe, so only call it
+     * while the pipe is not in use.
+     *
+     * @param admission Whether pushes into this pipe are limited by the budget,
+     * which should only be the case at the entry of the pipeline.
+     * @return False if the pipe holds no payloads to account.
+     */
+    virtual bool setMemoryBudget(std::shared_ptr<MemoryBudget> /*budget*/,
+                                 bool /*admission*/) noexcept
+    {
+        return false;
+    }
+    /**
+     * @brief Returns the payload bytes in the pipe, if it has a budget.
+     */
+    [[nodiscard]] size_t bytes() const noexcept
+    {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+
+    bool waitsForSlowestFilter() const noexcept
+    {
+        return m_waitForSlowestFilter;
+    }
+    bool isEnabled() const noexcept
+    {
+        return m_enabled;
+    }
+
     virtual unsigned int size() const noexcept
     {
-        return m_valid ? 1 : 0;
+        return (m_valid ? 1 : 0) + (hasResetMarker() ? 1 : 0);
     }
 
     void registerPushCallback(std::function<void()> pushCallback) noexcept
@@ -41,12 +119,184 @@ public:
         m_pushCallback = pushCallback;
     }
 
+    /**
+     * @brief Registers a callback for flush(), which the thread pushing into
+     * the pipe calls when it runs out of input.
+     */
+    void registerFlushCallback(std::function<void()> flushCallback) noexcept
+    {
+        m_flushCallback = flushCallback;
+    }
+    void flush() const
+    {
+        if (m_flushCallback)
+            m_flushCallback();
+    }
+
+    /**
+     * @brief Queues a reset marker behind the element in the pipe. The stage
+     * reading from the pipe resets its filter when the marker reaches it and
+     * hands the marker on until the given number of stages is reset.
+     *
+     * Elements pushed after the marker wait until it is taken out, so they are
+     * processed by the reset filters only.
+     *
+     * @param stages Number of stages to reset, including the one reading from
+     * this pipe.
+     * @param processPending Whether the elements ahead of the marker are still
+     * processed or dropped from the pipes the marker passes.
+     */
+    void pushResetMarker(uint32_t stages, bool processPending) noexcept
+    {
+        if (stages == 0)
+            return;
+
+        stages = std::max(stages, m_resetMarker.load());
+        if (!processPending)
+            reset();
+        m_processPending.store(processPending, std::memory_order_relaxed);
+        m_resetMarker.store(stages, std::memory_order_release);
+
+        m_pushCallback();
+    }
+
+    /**
+     * @brief Takes the reset marker out of the pipe once there is no element
+     * ahead of it.
+     *
+     * @return The number of stages still to reset including the calling one,
+     * or 0 if there is no marker to take.
+     */
+    uint32_t takeResetMarker(bool& processPending) noexcept
+    {
+        if (!hasResetMarker() || size() > 1)
+            return 0;
+
+        uint32_t stages = m_resetMarker.exchange(0, std::memory_order_acquire);
+        processPending  = m_processPending.load(std::memory_order_relaxed);
+        return stages;
+    }
+
+    [[nodiscard]] bool hasResetMarker() const noexcept
+    {
+        return m_resetMarker.load(std::memory_order_relaxed) != 0;
+    }
+
+    /**
+     * @brief In pull mode, the stage pushing into the pipe only runs while
+     * elements are requested from the pipe, see request(). Drops the demand,
+     * so only call it while the pipe is not in use.
+     */
+    void setPullMode(bool pull) noexcept
+    {
+        m_pullMode = pull;
+        m_demand.store(0, std::memory_order_relaxed);
+    }
+    [[nodiscard]] bool isPullMode() const noexcept
+    {
+        return m_pullMode;
+    }
+
+    /**
+     * @brief Requests count more elements from a pipe in pull mode and wakes
+     * the stage pushing into it. Each element entering the pipe fulfills one
+     * request.
+     */
+    void request(uint32_t count = 1) noexcept
+    {
+        if (!m_pullMode || !m_enabled || count == 0)
+            return;
+
+        m_demand.fetch_add(count, std::memory_order_acq_rel);
+        m_demandCallback();
+    }
+    /**
+     * @brief Raises the number of requested elements to count, unless more are
+     * requested already.
+     */
+    void requestUpTo(uint32_t count) noexcept
+    {
+        if (!m_pullMode || !m_enabled)
+            return;
+
+        uint32_t demand = m_demand.load(std::memory_order_acquire);
+        while (demand < count) {
+            if (m_demand.compare_exchange_weak(
+                    demand, count, std::memory_order_acq_rel)) {
+                m_demandCallback();
+                return;
+            }
+        }
+    }
+    /**
+     * @brief Withdraws up to count requests that haven't been fulfilled yet,
+     * e.g. when giving up waiting for them.
+     */
+    void cancelRequest(uint32_t count = 1) noexcept
+    {
+        uint32_t demand = m_demand.load(std::memory_order_acquire);
+        while (demand > 0
+               && !m_demand.compare_exchange_weak(
+                   demand,
+                   demand - std::min(demand, count),
+                   std::memory_order_acq_rel)) {}
+    }
+    /**
+     * @brief Returns the number of requested elements that haven't entered the
+     * pipe yet.
+     */
+    [[nodiscard]] uint32_t demand() const noexcept
+    {
+        return m_demand.load(std::memory_order_acquire);
+    }
+    /**
+     * @brief Returns whether the stage pushing into the pipe should produce an
+     * element, which is always the case outside of pull mode.
+     */
+    [[nodiscard]] bool isDemanded() const noexcept
+    {
+        return !m_pullMode || demand() > 0;
+    }
+
+    /**
+     * @brief Registers the callback request() calls, which wakes the stage
+     * pushing into the pipe.
+     */
+    void registerDemandCallback(std::function<void()> demandCallback) noexcept
+    {
+        m_demandCallback = demandCallback;
+    }
+
+protected:
+    /**
+     * @brief Counts an element entering the pipe against the requests.
+     */
+    void fulfillRequest() noexcept
+    {
+        if (m_pullMode)
+            cancelRequest(1);
+    }
+
 protected:
     std::atomic<bool> m_valid;
     bool m_waitForSlowestFilter;
-    bool m_enabled;
+    std::atomic<bool> m_enabled;
+
+    /// number of stages the queued reset marker resets, 0 if there is none
+    std::atomic<uint32_t> m_resetMarker{0};
+    std::atomic<bool> m_processPending{true};
 
     std::function<void()> m_pushCallback = [] {};
+    std::function<void()> m_flushCallback;
+
+    bool m_pullMode = false;
+    /// number of requested elements, only in pull mode
+    std::atomic<uint32_t> m_demand{0};
+    std::function<void()> m_demandCallback = [] {};
+
+    std::shared_ptr<MemoryBudget> m_budget;
+    bool m_admission = false;
+    std::atomic<size_t> m_bytes{0};
 };
 
 } // namespace blpl
@@ -1,24 +1,77 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
 
 #include "AbstractFilter.h"
 #include "AbstractFilterThread.h"
+#include "AbstractPipe.h"
+#include "BottleneckReport.h"
+#include "Checkpoint.h"
+#include "FilterError.h"
+#include "FilterMetrics.h"
+#include "MemoryBudget.h"
+#include "Pipe.h"
+#include "Tracer.h"
+#include "Watchdog.h"
 
 namespace blpl {
 
-struct FilterMetrics
-{
-    uint32_t counter;
-    std::chrono::duration<double> wallTime;
-};
-
 class AbstractPipeline
 {
 public:
+    AbstractPipeline() = default;
+    AbstractPipeline(AbstractPipeline&& other)
+    {
+        *this = std::move(other);
+    }
+    /**
+     * @brief Takes over the stages of other. A watchdog running on other keeps
+     * watching them, with the same settings.
+     */
+    AbstractPipeline& operator=(AbstractPipeline&& other)
+    {
+        if (this == &other)
+            return *this;
+
+        // the watchdog refers to the pipeline it was started on
+        m_watchdog.reset();
+        bool watched = other.m_watchdog != nullptr;
+        other.m_watchdog.reset();
+
+        m_filterThreads    = std::move(other.m_filterThreads);
+        m_filters          = std::move(other.m_filters);
+        m_pipes            = std::move(other.m_pipes);
+        m_budget           = std::move(other.m_budget);
+        m_running          = other.m_running;
+        m_startTime        = other.m_startTime;
+        m_runTime          = other.m_runTime;
+        m_stallThreshold   = other.m_stallThreshold;
+        m_watchdogInterval = other.m_watchdogInterval;
+        m_onStall          = std::move(other.m_onStall);
+        m_stallsReported   = std::move(other.m_stallsReported);
+
+        if (watched)
+            runWatchdog();
+        return *this;
+    }
+
     void start()
     {
+        if (!m_running) {
+            m_running   = true;
+            m_startTime = std::chrono::steady_clock::now();
+        }
+
         for (auto& filter : m_filterThreads) {
             filter->start();
         }
@@ -29,6 +82,11 @@ public:
         for (auto& filter : m_filterThreads) {
             filter->stop();
         }
+
+        if (m_running) {
+            m_running = false;
+            m_runTime += std::chrono::steady_clock::now() - m_startTime;
+        }
     }
 
     void reset()
@@ -38,6 +96,146 @@ public:
         }
     }
 
+    /**
+     * @brief Resets the filters of count stages starting at first, without
+     * stopping any thread.
+     *
+     * A reset marker is queued into the in pipe of the first stage. Each stage
+     * resets its filter when the marker reaches it and hands the marker on to
+     * the next stage, so elements pushed afterwards are only processed by reset
+     * filters. If the pipeline isn't running, the filters are reset right away.
+     *
+     * @param processPending Whether the elements ahead of the marker are still
+     * processed, or dropped from the pipes the marker passes.
+     * @return False if there is no such stage.
+     */
+    bool resetStages(size_t first, size_t count, bool processPending = true)
+    {
+        if (first >= m_filters.size() || count == 0)
+            return false;
+        count = std::min(count, m_filters.size() - first);
+
+        if (!m_running) {
+            auto thread = std::next(m_filterThreads.begin(), first);
+            for (size_t i = 0; i < count; ++i)
+                (*thread++)->reset();
+            return true;
+        }
+
+        auto pipe = std::next(m_pipes.begin(), first);
+        (*pipe)->pushResetMarker(static_cast<uint32_t>(count), processPending);
+        return true;
+    }
+
+    /**
+     * @brief Lets the in pipe of the given stage, or the out pipe of the
+     * pipeline for stage == length(), queue up to capacity elements. Several
+     * threads may push into such a pipe at the same time, e.g. into the in pipe
+     * of the pipeline. A capacity of 0 makes it a single slot again.
+     *
+     * @note Only call this while the pipeline is stopped, elements in the pipe
+     * are dropped.
+     *
+     * @return False if there is no such pipe or it can't queue elements, like
+     * the in pipe of a Generator.
+     */
+    bool setPipeCapacity(size_t stage, size_t capacity)
+    {
+        if (stage >= m_pipes.size())
+            return false;
+
+        return (*std::next(m_pipes.begin(), stage))->setCapacity(capacity);
+    }
+
+    /**
+     * @brief Gives the in pipe of the given stage, or the out pipe of the
+     * pipeline for stage == length(), a number of priority levels with room
+     * for capacity elements each. The stage reading from it then always takes
+     * the most urgent element, where the level of an element is given by
+     * PriorityOf. Give all pipes the same levels, so urgent elements overtake
+     * bulk ones in every stage.
+     *
+     * @note Only call this while the pipeline is stopped, elements in the pipe
+     * are dropped.
+     *
+     * @param starvationLimit How often a non-empty level may be passed over
+     * before it is served anyway, 0 for strict priorities.
+     * @return False if there is no such pipe or it can't queue elements.
+     */
+    bool setPipePriorities(size_t stage,
+                           size_t levels,
+                           size_t capacity,
+                           uint32_t starvationLimit = 16)
+    {
+        if (stage >= m_pipes.size())
+            return false;
+
+        return (*std::next(m_pipes.begin(), stage))
+            ->setPriorityLevels(levels, capacity, starvationLimit);
+    }
+    /**
+     * @brief Returns how long the elements of each priority level waited in
+     * the in pipe of the given stage, or the out pipe for stage == length().
+     */
+    [[nodiscard]] std::vector<PriorityMetrics>
+    pipePriorityMetrics(size_t stage) const
+    {
+        if (stage >= m_pipes.size())
+            return {};
+
+        return (*std::next(m_pipes.begin(), stage))->priorityMetrics();
+    }
+
+    /**
+     * @brief Accounts the payload bytes in all pipes of the pipeline and limits
+     * them to limit bytes at its entry, see MemoryBudget. A limit of 0 only
+     * accounts them. The size of a payload is taken from PayloadSize.
+     *
+     * @note Only call this while the pipeline is stopped, elements in the pipes
+     * are dropped.
+     */
+    void setMemoryBudget(size_t limit,
+                         BudgetPolicy policy = BudgetPolicy::Block)
+    {
+        m_budget = std::make_shared<MemoryBudget>(limit, policy);
+
+        // the first pipe holding payloads is the entry of the pipeline
+        bool admission = true;
+        for (auto& pipe : m_pipes) {
+            if (pipe->setMemoryBudget(m_budget, admission))
+                admission = false;
+        }
+    }
+    void removeMemoryBudget()
+    {
+        m_budget.reset();
+        for (auto& pipe : m_pipes)
+            pipe->setMemoryBudget(nullptr, false);
+    }
+
+    /**
+     * @brief Returns the budget with the total bytes in flight and the number
+     * of dropped elements, nullptr if the pipeline has none.
+     */
+    [[nodiscard]] std::shared_ptr<const MemoryBudget>
+    memoryBudget() const noexcept
+    {
+        return m_budget;
+    }
+    /**
+     * @brief Returns the payload bytes in the in pipes of all stages followed
+     * by those in the out pipe of the pipeline.
+     */
+    [[nodiscard]] std::vector<size_t> pipeBytes() const
+    {
+        std::vector<size_t> bytes;
+        bytes.reserve(m_pipes.size());
+        for (auto& pipe : m_pipes)
+            bytes.push_back(pipe->bytes());
+
+        return bytes;
+    }
+
     [[nodiscard]] size_t length() const noexcept
     {
         return m_filters.size();
@@ -48,9 +246,412 @@ public:
         return m_filters;
     }
 
+    /**
+     * @brief Swaps the filter of the given stage for another one of the same
+     * type, without stopping the pipeline. Only the thread of that stage
+     * pauses until the element it is working on is done.
+     *
+     * @return False if there is no such stage, the filter has different in or
+     * out data types, or the stage doesn't support swapping its filter.
+     */
+    bool replaceFilter(size_t stage, std::shared_ptr<AbstractFilter> filter)
+    {
+        if (stage >= m_filters.size() || !filter)
+            return false;
+
+        auto thread = std::next(m_filterThreads.begin(), stage);
+        if (!(*thread)->replaceFilter(filter))
+            return false;
+
+        // the watchdog reads the filters, the old one is released unlocked
+        auto& slot = *std::next(m_filters.begin(), stage);
+        {
+            std::scoped_lock<std::mutex> lock(m_filtersMutex);
+            std::swap(slot, filter);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Writes the states of all filters, see AbstractFilter::snapshot(),
+     * to a checkpoint file at path, from which restore() brings the filters of
+     * a pipeline of the same types back into this state.
+     *
+     * A running pipeline is quiesced at an element boundary first: the stages
+     * are paused one after the other, each once the stages before it are
+     * paused and its in pipe is drained, so the states of all stages reflect
+     * the same input. Then the states are written one stage at a time from the
+     * last one, which resumes as soon as its state is on disk. Elements waiting
+     * in the in pipe of the first stage are not part of the checkpoint.
+     *
+     * @note Results must keep flowing out of the pipeline meanwhile, i.e. a
+     * waiting out pipe has to be emptied by someone.
+     *
+     * @return False if a stage can't be paused or the file can't be written.
+     * The previous checkpoint at path is kept then, as it is if a snapshot
+     * throws. The stages are resumed before the exception is passed on.
+     */
+    bool checkpoint(const std::string& path)
+    {
+        std::vector<AbstractFilterThread*> paused;
+        if (m_running) {
+            auto pipe = m_pipes.begin();
+            for (auto& thread : m_filterThreads) {
+                if (!paused.empty()) {
+                    while ((*pipe)->size() > 0)
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds(100));
+                }
+                ++pipe;
+
+                if (!thread->pause()) {
+                    for (auto* pausedThread : paused)
+                        pausedThread->resume();
+                    return false;
+                }
+                paused.push_back(thread.get());
+            }
+        }
+
+        try {
+            detail::CheckpointWriter writer(path);
+            for (auto filter = m_filters.rbegin(); filter != m_filters.rend();
+                 ++filter) {
+                writer.write(**filter);
+                if (!paused.empty()) {
+                    paused.back()->resume();
+                    paused.pop_back();
+                }
+            }
+
+            return writer.commit();
+        } catch (...) {
+            // a failing snapshot must not leave the pipeline stalled
+            for (auto* pausedThread : paused)
+                pausedThread->resume();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Restores the states of the filters from a checkpoint written by
+     * checkpoint(). Only call this while the pipeline is stopped.
+     *
+     * @return False if the pipeline is running, the checkpoint is missing or
+     * was written by a pipeline with different filters, or a filter couldn't
+     * restore its state. The filters are left untouched in the first cases.
+     */
+    bool restore(const std::string& path)
+    {
+        if (m_running)
+            return false;
+
+        auto stages = detail::CheckpointReader(path).stages();
+        if (!stages || stages->size() != m_filters.size())
+            return false;
+
+        auto stage = stages->begin();
+        for (auto& filter : m_filters) {
+            const AbstractFilter& ref = *filter;
+            if (stage++->type != typeid(ref).name())
+                return false;
+        }
+
+        stage = stages->begin();
+        for (auto& filter : m_filters) {
+            if (stage->state && !filter->restore(*stage->state))
+                return false;
+            ++stage;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Starts a thread that checks every interval whether a filter has
+     * been processing the same element for longer than threshold, and calls
+     * onStall once per stalled element with a report naming the filter and the
+     * states of all pipes. Replaces a running watchdog.
+     *
+     * Only stages driven by a FilterThread are watched.
+     *
+     * @note onStall is called on the watchdog thread. The watchdog moves along
+     * with the pipeline, while extending the pipeline with operator| stops it.
+     *
+     * @param interval Time between two checks, a quarter of threshold by
+     * default.
+     */
+    void startWatchdog(std::chrono::steady_clock::duration threshold,
+                       std::function<void(const StallReport&)> onStall,
+                       std::chrono::steady_clock::duration interval = {})
+    {
+        using Clock = std::chrono::steady_clock;
+
+        m_watchdog.reset();
+        if (interval <= Clock::duration::zero())
+            interval = std::max<Clock::duration>(threshold / 4,
+                                                 std::chrono::milliseconds(1));
+
+        m_stallThreshold   = threshold;
+        m_watchdogInterval = interval;
+        m_onStall          = std::move(onStall);
+        m_stallsReported.clear();
+        runWatchdog();
+    }
+    void stopWatchdog() noexcept
+    {
+        m_watchdog.reset();
+    }
+
+    /**
+     * @brief Switches the pipeline to pull mode, where a stage only runs while
+     * results are requested from its out pipe, e.g. by Pipeline::pullFor().
+     * A stage without input passes the request on to the stage in front of
+     * it, so only the stages needed for a result run and the threads of a
+     * pipeline nobody requests results from sleep.
+     *
+     * @note Only call this while the pipeline is stopped. checkpoint() waits
+     * for the pipes between the stages to drain, which needs requests in pull
+     * mode.
+     *
+     * @return False if a stage doesn't support pull mode. The stages behind it
+     * pull then, while it and the ones in front of it run eagerly.
+     */
+    bool setPullMode(bool pull)
+    {
+        for (auto thread = m_filterThreads.rbegin();
+             thread != m_filterThreads.rend();
+             ++thread) {
+            if (!(*thread)->setPullMode(pull) && pull)
+                return false;
+        }
+
+        return true;
+    }
+    /**
+     * @brief Lets the given stage keep its last result and answer requests in
+     * pull mode with it while the stages in front compute a new input.
+     *
+     * @return False if there is no such stage or it can't cache its results.
+     */
+    bool setStageCache(size_t stage, bool caching)
+    {
+        if (stage >= m_filterThreads.size())
+            return false;
+
+        return (*std::next(m_filterThreads.begin(), stage))
+            ->setCaching(caching);
+    }
+
+    /**
+     * @brief Calls sink with each exception a stage catches while handling an
+     * element. The stage drops the element and keeps running. Without a sink,
+     * errors are only counted in the metrics.
+     *
+     * An exception of a sub-filter drops the whole vector of a MultiFilter
+     * stage. Set the sink once the pipeline is complete, stages added
+     * afterwards don't get it.
+     *
+     * @note sink is called on the thread of the failing stage, so it must be
+     * thread-safe and should return quickly.
+     */
+    void setErrorSink(std::function<void(const FilterError&)> sink)
+    {
+        size_t stage = 0;
+        for (auto& thread : m_filterThreads) {
+            if (sink) {
+                thread->setErrorHandler([sink, stage](FilterError&& error) {
+                    error.stage = stage;
+                    sink(error);
+                });
+            } else {
+                thread->setErrorHandler(nullptr);
+            }
+            ++stage;
+        }
+    }
+
+    /**
+     * @brief Routes the errors of all stages into a discarding pipe of the
+     * given capacity instead of an error sink, keeping the latest ones if
+     * nobody takes them out.
+     */
+    std::shared_ptr<Pipe<FilterError>> makeDeadLetterPipe(size_t capacity = 64)
+    {
+        auto pipe = std::make_shared<Pipe<FilterError>>(false, capacity);
+        setErrorSink([pipe](const FilterError& error) {
+            pipe->push(FilterError(error));
+        });
+
+        return pipe;
+    }
+
+    /**
+     * @brief Returns the metrics of all stages in the order of filters().
+     */
+    [[nodiscard]] std::vector<FilterMetrics> metrics() const
+    {
+        std::vector<FilterMetrics> metrics;
+        metrics.reserve(m_filterThreads.size());
+        for (auto& filter : m_filterThreads)
+            metrics.push_back(filter->metrics());
+
+        return metrics;
+    }
+
+    /**
+     * @brief Returns the time the pipeline was running since construction or
+     * the last call to resetMetrics().
+     */
+    [[nodiscard]] std::chrono::duration<double> elapsed() const noexcept
+    {
+        auto elapsed = m_runTime;
+        if (m_running)
+            elapsed += std::chrono::steady_clock::now() - m_startTime;
+
+        return elapsed;
+    }
+
+    /**
+     * @brief Computes the utilization of all stages over the time the pipeline
+     * was running and finds the stage limiting its throughput.
+     *
+     * The time a stage was neither processing nor handing its results to the
+     * next stage is counted as starvation.
+     */
+    [[nodiscard]] BottleneckReport bottleneckReport() const
+    {
+        // read the metrics first, so they don't exceed the elapsed time
+        auto metrics       = this->metrics();
+        double elapsedTime = elapsed().count();
+
+        std::vector<StageReport> stages;
+        stages.reserve(m_filters.size());
+        auto filter = m_filters.begin();
+        for (auto& stageMetrics : metrics) {
+            StageReport stage;
+            stage.filter  = *filter++;
+            stage.metrics = stageMetrics;
+
+            if (elapsedTime > 0.) {
+                stage.utilization = stageMetrics.wallTime.count() / elapsedTime;
+                stage.blocking = stageMetrics.blockedTime.count() / elapsedTime;
+                stage.starvation =
+                    std::max(0., 1. - stage.utilization - stage.blocking);
+            }
+            if (stageMetrics.wallTime.count() > 0.)
+                stage.capacity =
+                    stageMetrics.counter / stageMetrics.wallTime.count();
+
+            stages.push_back(std::move(stage));
+        }
+
+        return BottleneckReport(std::move(stages),
+                                std::chrono::duration<double>(elapsedTime));
+    }
+
+    /**
+     * @brief Resets the metrics of all stages and the elapsed time.
+     */
+    void resetMetrics() noexcept
+    {
+        for (auto& filter : m_filterThreads)
+            filter->resetMetrics();
+
+        m_runTime   = std::chrono::duration<double>::zero();
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
 protected:
     std::list<std::shared_ptr<AbstractFilterThread>> m_filterThreads;
     std::list<std::shared_ptr<AbstractFilter>> m_filters;
+    /// the in pipes of all stages followed by the out pipe of the pipeline
+    std::list<std::shared_ptr<AbstractPipe>> m_pipes;
+
+private:
+    void runWatchdog()
+    {
+        m_watchdog = std::make_unique<detail::Watchdog>(
+            m_watchdogInterval, [this] { checkStalls(); });
+    }
+
+    /**
+     * @brief Reports the stages that have been processing the same element for
+     * longer than the threshold, unless they were reported for it before.
+     * Called on the watchdog thread.
+     */
+    void checkStalls()
+    {
+        auto now = std::chrono::steady_clock::now();
+        m_stallsReported.resize(m_filterThreads.size());
+
+        size_t stage = 0;
+        auto filter  = m_filters.begin();
+        for (auto& thread : m_filterThreads) {
+            auto since = thread->processingSince();
+            if (since && now - *since > m_stallThreshold &&
+                m_stallsReported[stage] != *since) {
+                m_stallsReported[stage] = *since;
+
+                std::shared_ptr<AbstractFilter> stalled;
+                {
+                    std::scoped_lock<std::mutex> lock(m_filtersMutex);
+                    stalled = *filter;
+                }
+                m_onStall(stallReport(stage, stalled, now - *since));
+            }
+            ++stage;
+            ++filter;
+        }
+    }
+
+    StallReport
+    stallReport(size_t stage,
+                const std::shared_ptr<AbstractFilter>& filter,
+                std::chrono::steady_clock::duration stalledFor) const
+    {
+        const AbstractFilter& ref = *filter;
+
+        StallReport report;
+        report.stage      = stage;
+        report.filter     = filter;
+        report.filterName = Tracer::demangle(typeid(ref).name());
+        report.inType     = Tracer::demangle(ref.getInDataTypeInfo().name());
+        report.outType    = Tracer::demangle(ref.getOutDataTypeInfo().name());
+        report.stalledFor = stalledFor;
+
+        report.pipes.reserve(m_pipes.size());
+        for (auto& pipe : m_pipes) {
+            PipeState state;
+            state.size    = pipe->size();
+            state.enabled = pipe->isEnabled();
+            state.waiting = pipe->waitsForSlowestFilter();
+            state.bytes   = pipe->bytes();
+            report.pipes.push_back(state);
+        }
+
+        return report;
+    }
+
+private:
+    std::shared_ptr<MemoryBudget> m_budget;
+
+    bool m_running = false;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::chrono::duration<double> m_runTime{};
+
+    /// guards replacing the elements of m_filters against the watchdog
+    std::mutex m_filtersMutex;
+    /// settings of the watchdog, kept to restart it after a move
+    std::chrono::steady_clock::duration m_stallThreshold{};
+    std::chrono::steady_clock::duration m_watchdogInterval{};
+    std::function<void(const StallReport&)> m_onStall;
+    /// when each stage started the element it was last reported for, only
+    /// used by the watchdog thread
+    std::vector<std::chrono::steady_clock::time_point> m_stallsReported;
+
+    /// declared last, so it stops before the stages are destroyed
+    std::unique_ptr<detail::Watchdog> m_watchdog;
 };
 
 } // namespace blpl
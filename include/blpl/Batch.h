@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace blpl {
+
+/**
+ * @brief Payload of up to Capacity elements stored as structure of arrays: one
+ * contiguous column per element type.
+ *
+ * Passing batches instead of single numbers through the pipeline amortizes
+ * the per-element overhead of the pipes and filters and lets the compiler
+ * vectorize loops over the columns, see BatchFilter. The columns are aligned
+ * for AVX-512 and live on the heap, so moving a batch only moves a pointer.
+ *
+ * @tparam Columns Types of the columns, have to be trivially copyable.
+ */
+template <size_t Capacity, class... Columns>
+class Batch
+{
+    static_assert(Capacity > 0, "Batches need a capacity");
+    static_assert(sizeof...(Columns) > 0, "Batches need at least one column");
+    static_assert((std::is_trivially_copyable<Columns>::value && ...),
+                  "Columns have to be trivially copyable");
+
+public:
+    static constexpr size_t capacity = Capacity;
+    /// alignment of the columns in bytes, enough for AVX-512 loads
+    static constexpr size_t alignment = 64;
+
+    template <size_t I>
+    using ColumnType = std::tuple_element_t<I, std::tuple<Columns...>>;
+
+    Batch()
+        : m_storage(new Storage)
+    {}
+
+    Batch(const Batch& other)
+        : m_storage(new Storage(*other.m_storage))
+        , m_size(other.m_size)
+    {}
+
+    /// @note A moved-from batch can only be assigned to or destroyed.
+    Batch(Batch&&) noexcept = default;
+
+    Batch& operator=(const Batch& other)
+    {
+        if (this != &other) {
+            if (!m_storage)
+                m_storage.reset(new Storage);
+            *m_storage = *other.m_storage;
+            m_size     = other.m_size;
+        }
+        return *this;
+    }
+    Batch& operator=(Batch&&) noexcept = default;
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_size;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+    [[nodiscard]] bool full() const noexcept
+    {
+        return m_size == Capacity;
+    }
+
+    void clear() noexcept
+    {
+        m_size = 0;
+    }
+
+    /**
+     * @brief Sets the number of elements, new elements are uninitialized.
+     */
+    void resize(size_t size) noexcept
+    {
+        assert(size <= Capacity);
+        m_size = size;
+    }
+
+    /**
+     * @brief Appends one element, given as the values of all columns.
+     */
+    void push(Columns... values) noexcept
+    {
+        assert(!full());
+        pushColumns(std::index_sequence_for<Columns...>(), values...);
+        ++m_size;
+    }
+
+    /**
+     * @brief Returns the start of column I, aligned to alignment bytes.
+     */
+    template <size_t I>
+    [[nodiscard]] ColumnType<I>* column() noexcept
+    {
+        return std::get<I>(m_storage->columns).data;
+    }
+    template <size_t I>
+    [[nodiscard]] const ColumnType<I>* column() const noexcept
+    {
+        return std::get<I>(m_storage->columns).data;
+    }
+
+private:
+    template <size_t... I>
+    void pushColumns(std::index_sequence<I...>, Columns... values) noexcept
+    {
+        ((column<I>()[m_size] = values), ...);
+    }
+
+    template <class T>
+    struct alignas(alignment) Column
+    {
+        T data[Capacity];
+    };
+
+    struct Storage
+    {
+        std::tuple<Column<Columns>...> columns;
+    };
+
+private:
+    std::unique_ptr<Storage> m_storage;
+    size_t m_size = 0;
+};
+
+} // namespace blpl
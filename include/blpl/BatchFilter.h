@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "Batch.h"
+#include "Filter.h"
+
+namespace blpl {
+
+namespace detail {
+
+template <class Func, class... Columns>
+using BatchResult = std::decay_t<std::invoke_result_t<Func&, Columns...>>;
+
+} // namespace detail
+
+template <class InBatch, class Func>
+class BatchFilter;
+
+/**
+ * @brief Filter that lifts a scalar function to batches: it calls the function
+ * with the values of all columns of each element and stores the results in a
+ * batch with a single column.
+ *
+ * The function is stored by its concrete type and called in a plain loop over
+ * the columns, so the compiler can inline and vectorize it. If the output
+ * batch has the same type as the input, the results overwrite the first
+ * column of the input instead of allocating a new batch.
+ */
+template <size_t Capacity, class... Columns, class Func>
+class BatchFilter<Batch<Capacity, Columns...>, Func>
+    : public Filter<Batch<Capacity, Columns...>,
+                    Batch<Capacity, detail::BatchResult<Func, Columns...>>>
+{
+public:
+    using InBatch  = Batch<Capacity, Columns...>;
+    using OutBatch = Batch<Capacity, detail::BatchResult<Func, Columns...>>;
+
+    explicit BatchFilter(Func func)
+        : m_func(std::move(func))
+    {}
+
+protected:
+    OutBatch processImpl(InBatch&& in) override
+    {
+        constexpr auto columns = std::index_sequence_for<Columns...>();
+        if constexpr (std::is_same<InBatch, OutBatch>::value) {
+            apply(in, in.template column<0>(), columns);
+            return std::move(in);
+        } else {
+            OutBatch out;
+            out.resize(in.size());
+            apply(in, out.template column<0>(), columns);
+            return out;
+        }
+    }
+
+private:
+    template <class Result, size_t... I>
+    void apply(const InBatch& in, Result* result, std::index_sequence<I...>)
+    {
+        const auto columns = std::make_tuple(in.template column<I>()...);
+        const size_t size  = in.size();
+        for (size_t i = 0; i < size; ++i)
+            result[i] = m_func(std::get<I>(columns)[i]...);
+    }
+
+private:
+    Func m_func;
+};
+
+/**
+ * @brief Creates a BatchFilter for batches of type InBatch from a scalar
+ * function, e.g. a lambda.
+ */
+template <class InBatch, class Func>
+BatchFilter<InBatch, std::decay_t<Func>> makeBatchFilter(Func&& func)
+{
+    return BatchFilter<InBatch, std::decay_t<Func>>(std::forward<Func>(func));
+}
+
+} // namespace blpl
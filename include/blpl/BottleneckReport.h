@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "AbstractFilter.h"
+#include "FilterMetrics.h"
+#include "Tracer.h"
+
+namespace blpl {
+
+/**
+ * @brief Utilization of one stage of a pipeline over the time it was running.
+ */
+struct StageReport
+{
+    std::shared_ptr<AbstractFilter> filter;
+    FilterMetrics metrics;
+
+    /// share of the elapsed time spent processing
+    double utilization = 0.;
+    /// share of the elapsed time spent waiting for input
+    double starvation = 0.;
+    /// share of the elapsed time spent waiting for the next stage
+    double blocking = 0.;
+    /// elements per second the stage could process if it never had to wait
+    double capacity = 0.;
+};
+
+/**
+ * @brief Per-stage utilization of a pipeline and the stage limiting its
+ * throughput, see AbstractPipeline::bottleneckReport().
+ *
+ * The limiting stage is the one with the lowest capacity, i.e. the one that
+ * needs the most time per element. The estimates assume that the stages don't
+ * compete for cores, so they are upper bounds on machines that are already
+ * saturated.
+ */
+class BottleneckReport
+{
+public:
+    BottleneckReport(std::vector<StageReport> stages,
+                     std::chrono::duration<double> elapsed)
+        : m_stages(std::move(stages))
+        , m_elapsed(elapsed)
+        , m_limitingStage(m_stages.size())
+    {
+        double lowest = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < m_stages.size(); ++i) {
+            if (m_stages[i].metrics.counter > 0 &&
+                m_stages[i].capacity < lowest) {
+                lowest          = m_stages[i].capacity;
+                m_limitingStage = i;
+            }
+        }
+    }
+
+    [[nodiscard]] const std::vector<StageReport>& stages() const noexcept
+    {
+        return m_stages;
+    }
+
+    /**
+     * @brief Returns the time the pipeline was running.
+     */
+    [[nodiscard]] std::chrono::duration<double> elapsed() const noexcept
+    {
+        return m_elapsed;
+    }
+
+    /**
+     * @brief Returns the index of the stage limiting the throughput or the
+     * number of stages, if no stage processed anything yet.
+     */
+    [[nodiscard]] size_t limitingStage() const noexcept
+    {
+        return m_limitingStage;
+    }
+
+    /**
+     * @brief Returns the number of elements per second the pipeline can process
+     * at most, given by the capacity of the limiting stage.
+     */
+    [[nodiscard]] double throughput() const noexcept
+    {
+        if (m_limitingStage == m_stages.size())
+            return 0.;
+        return m_stages[m_limitingStage].capacity;
+    }
+
+    /**
+     * @brief Estimates the factor by which the throughput of the pipeline
+     * improves if the limiting stage gets speedup times faster, e.g. by
+     * optimizing it or by replicating it speedup times in a MultiFilter. The
+     * gain is capped by the stage that becomes the bottleneck next.
+     */
+    [[nodiscard]] double estimatedGain(double speedup) const noexcept
+    {
+        if (m_limitingStage == m_stages.size())
+            return 1.;
+
+        double limit = m_stages[m_limitingStage].capacity;
+        double next  = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < m_stages.size(); ++i) {
+            if (i != m_limitingStage && m_stages[i].metrics.counter > 0)
+                next = std::min(next, m_stages[i].capacity);
+        }
+
+        return std::min(limit * speedup, next) / limit;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BottleneckReport& report)
+    {
+        auto flags     = out.flags();
+        auto precision = out.precision();
+        out << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < report.m_stages.size(); ++i) {
+            const auto& stage = report.m_stages[i];
+            out << (i == report.m_limitingStage ? "* " : "  ") << i << ' '
+                << Tracer::demangle(typeid(*stage.filter).name())
+                << ": busy " << stage.utilization * 100. << "%, starved "
+                << stage.starvation * 100. << "%, blocked "
+                << stage.blocking * 100. << "%, " << stage.capacity
+                << " elements/s\n";
+        }
+        if (report.m_limitingStage < report.m_stages.size())
+            out << "limited to " << report.throughput()
+                << " elements/s, twice as fast limiting stage: x"
+                << std::setprecision(2) << report.estimatedGain(2.) << '\n';
+        out.flags(flags);
+        out.precision(precision);
+
+        return out;
+    }
+
+private:
+    std::vector<StageReport> m_stages;
+    std::chrono::duration<double> m_elapsed;
+    size_t m_limitingStage;
+};
+
+} // namespace blpl
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeinfo>
+#include <vector>
+
+#include "AbstractFilter.h"
+
+namespace blpl {
+
+namespace detail {
+
+/**
+ * @brief Writes the states of the filters of a pipeline to a checkpoint file,
+ * one stage at a time.
+ *
+ * The file starts with a magic and the format version, followed by one record
+ * per stage from the last stage to the first: the type name of the filter,
+ * whether it has a state, and the size and bytes of the state. All numbers are
+ * in host byte order. The records are written to a temporary file that only
+ * replaces the checkpoint in commit(), so a crash in the middle of a checkpoint
+ * keeps the previous one.
+ */
+class CheckpointWriter
+{
+public:
+    /// checkpoint files start with this magic, followed by the version
+    static constexpr char magic[8] = {'B', 'L', 'P', 'L', 'C', 'K', 'P', 'T'};
+    static constexpr uint32_t version = 1;
+
+    explicit CheckpointWriter(const std::string& path)
+        : m_path(path)
+        , m_tmpPath(path + ".tmp")
+        , m_file(m_tmpPath, std::ios::binary | std::ios::trunc)
+    {
+        m_file.write(magic, sizeof(magic));
+        writeNumber(version);
+    }
+
+    ~CheckpointWriter()
+    {
+        if (m_file.is_open()) {
+            m_file.close();
+            std::error_code error;
+            std::filesystem::remove(m_tmpPath, error);
+        }
+    }
+
+    /**
+     * @brief Appends the record of the next stage and writes it out, so the
+     * states never have to be held in memory at the same time.
+     */
+    void write(const AbstractFilter& filter)
+    {
+        std::string_view type = typeid(filter).name();
+        writeNumber(static_cast<uint32_t>(type.size()));
+        m_file.write(type.data(), type.size());
+
+        m_state.clear();
+        bool hasState = filter.snapshot(m_state);
+        writeNumber(static_cast<uint8_t>(hasState));
+        if (!hasState)
+            m_state.clear();
+        writeNumber(static_cast<uint64_t>(m_state.size()));
+        m_file.write(m_state.data(), m_state.size());
+        m_file.flush();
+    }
+
+    /**
+     * @brief Replaces the checkpoint with the records written so far. Returns
+     * false if any of them couldn't be written.
+     */
+    bool commit()
+    {
+        m_file.close();
+        if (!m_file)
+            return false;
+
+        std::error_code error;
+        std::filesystem::rename(m_tmpPath, m_path, error);
+        return !error;
+    }
+
+private:
+    template <class T>
+    void writeNumber(T number)
+    {
+        m_file.write(reinterpret_cast<const char*>(&number), sizeof(number));
+    }
+
+private:
+    std::string m_path;
+    std::string m_tmpPath;
+    std::ofstream m_file;
+    /// reused for the states of all stages
+    std::string m_state;
+};
+
+/**
+ * @brief Reads the records of a checkpoint file written by CheckpointWriter.
+ */
+class CheckpointReader
+{
+public:
+    struct Stage
+    {
+        std::string type;
+        std::optional<std::string> state;
+    };
+
+    explicit CheckpointReader(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        m_data.assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    }
+
+    /**
+     * @brief Parses all records and returns them from the first stage to the
+     * last, nothing if the file is missing, truncated or of another version.
+     */
+    std::optional<std::vector<Stage>> stages() const
+    {
+        size_t offset = 0;
+        char magic[sizeof(CheckpointWriter::magic)];
+        uint32_t version;
+        if (!read(offset, magic, sizeof(magic)) ||
+            std::memcmp(magic, CheckpointWriter::magic, sizeof(magic)) != 0 ||
+            !read(offset, &version, sizeof(version)) ||
+            version != CheckpointWriter::version)
+            return std::nullopt;
+
+        std::vector<Stage> stages;
+        while (offset < m_data.size()) {
+            uint32_t typeSize;
+            uint8_t hasState;
+            uint64_t stateSize;
+
+            Stage stage;
+            if (!read(offset, &typeSize, sizeof(typeSize)) ||
+                !readString(offset, typeSize, stage.type) ||
+                !read(offset, &hasState, sizeof(hasState)) ||
+                !read(offset, &stateSize, sizeof(stateSize)))
+                return std::nullopt;
+
+            std::string state;
+            if (!readString(offset, stateSize, state))
+                return std::nullopt;
+            if (hasState)
+                stage.state = std::move(state);
+
+            stages.push_back(std::move(stage));
+        }
+        std::reverse(stages.begin(), stages.end());
+
+        return stages;
+    }
+
+private:
+    bool read(size_t& offset, void* out, size_t size) const
+    {
+        if (m_data.size() - offset < size)
+            return false;
+
+        std::memcpy(out, m_data.data() + offset, size);
+        offset += size;
+        return true;
+    }
+    bool readString(size_t& offset, uint64_t size, std::string& out) const
+    {
+        if (m_data.size() - offset < size)
+            return false;
+
+        out.assign(m_data.data() + offset, size);
+        offset += size;
+        return true;
+    }
+
+private:
+    std::string m_data;
+};
+
+} // namespace detail
+
+} // namespace blpl
@@ -0,0 +1,639 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "CoroutineFilter.h requires C++20 coroutines"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "AbstractFilterThread.h"
+#include "Deadline.h"
+#include "Filter.h"
+#include "FilterError.h"
+#include "FilterMetrics.h"
+#include "IoExecutor.h"
+#include "Pipe.h"
+#include "TraceScope.h"
+
+namespace blpl {
+
+template <class T>
+class Task;
+
+namespace detail {
+
+template <class T>
+class TaskPromiseBase
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        template <class Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            return handle.promise().m_continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+
+public:
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+    void unhandled_exception() noexcept
+    {
+        m_exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> m_continuation = std::noop_coroutine();
+    std::exception_ptr m_exception;
+};
+
+template <class T>
+class TaskPromise : public TaskPromiseBase<T>
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U&& value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    T result()
+    {
+        if (this->m_exception)
+            std::rethrow_exception(this->m_exception);
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase<void>
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result()
+    {
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief A lazily started coroutine producing a T, to be co_awaited by another
+ * coroutine.
+ *
+ * Exceptions thrown in the coroutine are rethrown at the co_await.
+ */
+template <class T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle)
+    {}
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+
+    ~Task()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> continuation) noexcept
+    {
+        m_handle.promise().m_continuation = continuation;
+        return m_handle;
+    }
+    T await_resume()
+    {
+        return m_handle.promise().result();
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(
+        std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief An eagerly started coroutine that nobody waits for. It destroys
+ * itself when done.
+ *
+ * Nobody could handle an exception escaping it, so it terminates. Coroutines
+ * run this way catch the exceptions of the elements they process themselves.
+ */
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+class Signal
+{
+public:
+    void set()
+    {
+        // notify while holding the lock, the waiter might destroy us
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_set = true;
+        m_condition.notify_all();
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_set; });
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_set = false;
+};
+
+template <class T>
+Detached runAndSignal(Task<T>& task,
+                      std::optional<T>& result,
+                      std::exception_ptr& exception,
+                      Signal& signal)
+{
+    try {
+        result.emplace(co_await task);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    signal.set();
+}
+
+/**
+ * @brief Runs the task and blocks the calling thread until it is done.
+ */
+template <class T>
+T syncWait(Task<T> task)
+{
+    std::optional<T> result;
+    std::exception_ptr exception;
+    Signal signal;
+    runAndSignal(task, result, exception, signal);
+    signal.wait();
+
+    if (exception)
+        std::rethrow_exception(exception);
+    return std::move(*result);
+}
+
+} // namespace detail
+
+/**
+ * @brief Awaitable that suspends the coroutine until the file descriptor is
+ * ready for the given direction and resumes it on an executor thread.
+ */
+class IoAwaiter
+{
+public:
+    IoAwaiter(IoExecutor& executor, int fd, bool writing) noexcept
+        : m_executor(executor)
+        , m_fd(fd)
+        , m_writing(writing)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the coroutine might be resumed before this returns, so we must not
+        // touch any members after registering
+        auto resume = [handle] { handle.resume(); };
+        if (m_writing)
+            m_executor.whenWritable(m_fd, std::move(resume));
+        else
+            m_executor.whenReadable(m_fd, std::move(resume));
+    }
+    void await_resume() const noexcept {}
+
+private:
+    IoExecutor& m_executor;
+    int m_fd;
+    bool m_writing;
+};
+
+/**
+ * @brief Awaitable that reschedules the coroutine on an executor thread,
+ * allowing other coroutines to run in the meantime.
+ */
+class ScheduleAwaiter
+{
+public:
+    explicit ScheduleAwaiter(IoExecutor& executor) noexcept
+        : m_executor(executor)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_executor.post([handle] { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    IoExecutor& m_executor;
+};
+
+template <class InData, class OutData>
+class CoroutineFilterThread;
+
+/**
+ * @brief A filter for I/O-bound stages, implemented as a coroutine that can
+ * suspend on file descriptors without holding a thread.
+ *
+ * In a Pipeline this filter is driven by a CoroutineFilterThread, which runs
+ * the coroutine on the IoExecutor of the filter instead of a dedicated thread.
+ * As for all filters, one instance still processes its input sequentially.
+ * When called through process() directly (or through a FilterPtr), the
+ * calling thread blocks until the coroutine is done.
+ *
+ * @note Requires C++20.
+ */
+template <class InData, class OutData>
+class CoroutineFilter : public Filter<InData, OutData>
+{
+public:
+    using threadType = CoroutineFilterThread<InData, OutData>;
+
+    explicit CoroutineFilter(
+        std::shared_ptr<IoExecutor> executor = IoExecutor::defaultExecutor())
+        : m_executor(std::move(executor))
+    {}
+
+    /**
+     * @brief The coroutine version of process(), also calls the listener.
+     */
+    Task<OutData> processAsync(InData&& in);
+
+    IoExecutor& executor() const noexcept
+    {
+        return *m_executor;
+    }
+
+protected:
+    /**
+     * @brief When implementing this interface, this is the part that's used in
+     * the pipeline.
+     *
+     * @param in Input data for this filter, stays valid until the returned
+     * task is done.
+     */
+    virtual Task<OutData> processAsyncImpl(InData&& in) = 0;
+
+    OutData processImpl(InData&& in) override
+    {
+        return detail::syncWait(processAsyncImpl(std::move(in)));
+    }
+
+    /// co_await this to wait until fd is readable
+    IoAwaiter readable(int fd) const noexcept
+    {
+        return {*m_executor, fd, false};
+    }
+    /// co_await this to wait until fd is writable
+    IoAwaiter writable(int fd) const noexcept
+    {
+        return {*m_executor, fd, true};
+    }
+
+private:
+    std::shared_ptr<IoExecutor> m_executor;
+};
+
+template <class InData, class OutData>
+Task<OutData> CoroutineFilter<InData, OutData>::processAsync(InData&& in)
+{
+    if (this->m_listener)
+        this->m_listener->preProcessCallback(this->toAny(in));
+    auto out = co_await processAsyncImpl(std::move(in));
+    if (this->m_listener)
+        this->m_listener->postProcessCallback(this->toAny(out));
+
+    co_return std::move(out);
+}
+
+/**
+ * @brief Drives a CoroutineFilter on its IoExecutor instead of a dedicated
+ * thread. The counterpart of FilterThread for coroutine filters.
+ *
+ * Whenever data is pushed into the in pipe, a coroutine is posted to the
+ * executor that processes all the data it finds in the pipe and ends as soon
+ * as the pipe is empty. Expired elements, see DeadlineOf, are skipped and
+ * exceptions thrown while handling an element drop it and are reported like
+ * in FilterThread.
+ */
+template <class InData, class OutData>
+class CoroutineFilterThread : public AbstractFilterThread
+{
+public:
+    CoroutineFilterThread(
+        std::shared_ptr<Pipe<InData>> inPipe,
+        std::shared_ptr<CoroutineFilter<InData, OutData>> filter,
+        std::shared_ptr<Pipe<OutData>> outPipe);
+
+    ~CoroutineFilterThread() override;
+
+    bool isFiltering() const noexcept;
+
+    void start() noexcept override;
+    void stop() noexcept override;
+    void reset() noexcept override;
+
+    /**
+     * @brief The time spent in processAsync() counts as busy, including the
+     * time the coroutine is suspended, as the filter can't take the next
+     * element meanwhile.
+     */
+    [[nodiscard]] FilterMetrics metrics() const noexcept override
+    {
+        return m_metrics.load();
+    }
+    void resetMetrics() noexcept override
+    {
+        m_metrics.reset();
+    }
+
+    bool setErrorHandler(
+        std::function<void(FilterError&&)> handler) noexcept override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_errorHandler = std::move(handler);
+
+        return true;
+    }
+
+private:
+    detail::Detached run();
+    void reportError(uint64_t sequence, std::exception_ptr exception) noexcept;
+
+private:
+    std::shared_ptr<Pipe<InData>> m_inPipe;
+    std::shared_ptr<CoroutineFilter<InData, OutData>> m_filter;
+    std::shared_ptr<Pipe<OutData>> m_outPipe;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_finished;
+    bool m_filtering = false;
+    bool m_active    = false;
+    std::function<void(FilterError&&)> m_errorHandler;
+
+    /// number of elements taken from the in pipe, only used by the coroutine
+    uint64_t m_sequence = 0;
+    detail::MetricsCounters m_metrics;
+};
+
+template <class InData, class OutData>
+CoroutineFilterThread<InData, OutData>::CoroutineFilterThread(
+    std::shared_ptr<Pipe<InData>> inPipe,
+    std::shared_ptr<CoroutineFilter<InData, OutData>> filter,
+    std::shared_ptr<Pipe<OutData>> outPipe)
+    : m_inPipe(std::move(inPipe))
+    , m_filter(std::move(filter))
+    , m_outPipe(std::move(outPipe))
+{
+    m_inPipe->registerPushCallback([this] { start(); });
+}
+
+template <class InData, class OutData>
+CoroutineFilterThread<InData, OutData>::~CoroutineFilterThread()
+{
+    stop();
+}
+
+template <class InData, class OutData>
+bool CoroutineFilterThread<InData, OutData>::isFiltering() const noexcept
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    return m_filtering;
+}
+
+/**
+ * @brief Starts the filter, posts the processing coroutine if it isn't alive.
+ */
+template <class InData, class OutData>
+void CoroutineFilterThread<InData, OutData>::start() noexcept
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    m_inPipe->enable();
+    m_outPipe->enable();
+    m_filtering = true;
+
+    if (!m_active) {
+        m_active = true;
+        m_filter->executor().post([this] { run(); });
+    }
+}
+
+/**
+ * @brief Stops the filter and waits until the processing coroutine finished
+ * the element it is working on.
+ */
+template <class InData, class OutData>
+void CoroutineFilterThread<InData, OutData>::stop() noexcept
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_inPipe->reset();
+    m_inPipe->disable();
+    m_outPipe->disable();
+    m_filtering = false;
+
+    m_finished.wait(lock, [this] { return !m_active; });
+}
+
+/**
+ * @brief Stops the filter, resets it and starts it back up.
+ */
+template <class InData, class OutData>
+void CoroutineFilterThread<InData, OutData>::reset() noexcept
+{
+    bool stopAndRestart = isFiltering();
+    if (stopAndRestart) {
+        stop();
+    }
+    m_filter->reset();
+    if (stopAndRestart) {
+        start();
+    }
+}
+
+/**
+ * @brief The processing coroutine, runs on the executor of the filter.
+ */
+template <class InData, class OutData>
+detail::Detached CoroutineFilterThread<InData, OutData>::run()
+{
+    using Clock = detail::MetricsCounters::Clock;
+
+    while (true) {
+        bool idle;
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            idle = !m_filtering || m_inPipe->size() < 1;
+        }
+        if (idle) {
+            m_outPipe->flush();
+
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            if (!m_filtering || m_inPipe->size() < 1) {
+                m_active = false;
+                m_finished.notify_all();
+                co_return;
+            }
+        }
+
+        bool processPending = true;
+        if (uint32_t stages = m_inPipe->takeResetMarker(processPending)) {
+            m_filter->reset();
+            if (stages > 1)
+                m_outPipe->pushResetMarker(stages - 1, processPending);
+            continue;
+        }
+
+        uint64_t sequence = m_sequence;
+        std::exception_ptr error;
+        try {
+            auto in = m_inPipe->tryPop();
+            if (!in)
+                continue;
+            ++m_sequence;
+            if (isExpired(*in)) {
+                m_metrics.addExpired();
+                continue;
+            }
+
+            auto begin = Clock::now();
+            std::optional<OutData> out;
+            {
+                TraceScope trace("filter", typeid(*m_filter).name());
+                out.emplace(
+                    co_await m_filter->processAsync(std::move(*in)));
+            }
+            auto done = Clock::now();
+
+            // don't block an executor thread on a waiting pipe
+            while (((m_outPipe->waitsForSlowestFilter() &&
+                     m_outPipe->size() > 0) ||
+                    m_outPipe->hasResetMarker()) &&
+                   m_outPipe->isEnabled())
+                co_await ScheduleAwaiter(m_filter->executor());
+
+            m_outPipe->push(std::move(*out));
+            m_metrics.add(done - begin, Clock::now() - done);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (error) {
+            // a throwing move out of the pipe has used up the element as well
+            m_sequence = sequence + 1;
+            reportError(sequence, std::move(error));
+        }
+    }
+}
+
+/**
+ * @brief Counts an exception and hands it to the error handler, if any.
+ */
+template <class InData, class OutData>
+void CoroutineFilterThread<InData, OutData>::reportError(
+    uint64_t sequence,
+    std::exception_ptr exception) noexcept
+{
+    m_metrics.addError();
+
+    FilterError error;
+    std::function<void(FilterError&&)> handler;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        if (!m_errorHandler)
+            return;
+        handler = m_errorHandler;
+    }
+    error.sequence  = sequence;
+    error.filter    = m_filter;
+    error.exception = std::move(exception);
+    try {
+        handler(std::move(error));
+    } catch (...) {
+        // the handler must not take the coroutine down
+    }
+}
+
+} // namespace blpl
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+namespace blpl {
+
+/**
+ * @brief Tells until when a payload is worth processing. The threads driving
+ * the stages skip elements whose deadline has passed before calling the
+ * filter, so a pipeline that falls behind doesn't spend its time on results
+ * nobody waits for anymore.
+ *
+ * By default payloads have no deadline. Specialize it for payloads that carry
+ * one, e.g. the capture time of a frame plus the tolerated latency.
+ */
+template <class T, class = void>
+struct DeadlineOf
+{
+    static std::optional<std::chrono::steady_clock::time_point>
+    of(const T&) noexcept
+    {
+        return std::nullopt;
+    }
+};
+
+/**
+ * @brief Returns whether the deadline of data has passed. Only reads the clock
+ * if data has a deadline.
+ */
+template <class T>
+bool isExpired(const T& data) noexcept
+{
+    auto deadline = DeadlineOf<T>::of(data);
+    return deadline && *deadline < std::chrono::steady_clock::now();
+}
+
+} // namespace blpl
@@ -1,11 +1,27 @@
 #pragma once
 
+#include <any>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "AbstractFilter.h"
+#include "TraceScope.h"
 
 namespace blpl {
 
+/**
+ * @brief Whether T can be copied. In contrast to std::is_copy_constructible
+ * this looks into std::vector, which claims to be copyable even if its
+ * elements aren't.
+ */
+template <class T>
+struct IsCopyable : std::is_copy_constructible<T>
+{};
+template <class T, class Alloc>
+struct IsCopyable<std::vector<T, Alloc>> : IsCopyable<T>
+{};
+
 /**
  * @brief This is the interface for all filters of the pipeline. It takes an
  * input, processes it and produces an output to be processed by the next
@@ -30,11 +46,12 @@ public:
 
     virtual OutData process(InData&& in)
     {
+        TraceScope trace("filter", typeid(*this).name());
         if (m_listener)
-            m_listener->preProcessCallback(in);
+            m_listener->preProcessCallback(toAny(in));
         auto out = processImpl(std::move(in));
         if (m_listener)
-            m_listener->postProcessCallback(out);
+            m_listener->postProcessCallback(toAny(out));
 
         return out;
     }
@@ -59,6 +76,20 @@ public:
     {
         return typeid(OutData);
     }
+
+protected:
+    /**
+     * @brief Copies the data into a std::any for the listener. Data that can't
+     * be copied is passed as an empty std::any.
+     */
+    template <class T>
+    static std::any toAny(const T& data)
+    {
+        if constexpr (IsCopyable<T>::value)
+            return data;
+        else
+            return std::any();
+    }
 };
 
 /// Convenience type for shared_ptr to filters
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+
+#include "AbstractFilter.h"
+
+namespace blpl {
+
+/**
+ * @brief An exception thrown while a stage of a pipeline handled an element.
+ * The stage drops the element and goes on with the next one.
+ */
+struct FilterError
+{
+    size_t stage = 0;
+    /// number of the element among those the stage took from its in pipe,
+    /// counting from 0
+    uint64_t sequence = 0;
+    std::shared_ptr<AbstractFilter> filter;
+    std::exception_ptr exception;
+
+    /**
+     * @brief Returns the message of the exception, if it is a std::exception.
+     */
+    [[nodiscard]] std::string what() const
+    {
+        try {
+            if (exception)
+                std::rethrow_exception(exception);
+        } catch (const std::exception& e) {
+            return e.what();
+        } catch (...) {
+        }
+
+        return {};
+    }
+};
+
+} // namespace blpl
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace blpl {
+
+/**
+ * @brief Metrics of one stage of a pipeline, collected by the thread driving
+ * its filter.
+ */
+struct FilterMetrics
+{
+    /// number of processed elements
+    uint32_t counter = 0;
+    /// time spent in the filter's process method
+    std::chrono::duration<double> wallTime{};
+    /// time spent handing the results to the next stage, which includes
+    /// waiting for it to take the previous result out of a waiting pipe
+    std::chrono::duration<double> blockedTime{};
+    /// number of elements skipped because their deadline had passed
+    uint32_t expired = 0;
+    /// number of elements dropped because handling them threw an exception
+    uint32_t errors = 0;
+};
+
+namespace detail {
+
+/**
+ * @brief Accumulates FilterMetrics in one thread while others read them.
+ */
+class MetricsCounters
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void add(Clock::duration busy,
+             Clock::duration blocked,
+             uint32_t count = 1) noexcept
+    {
+        m_counter.fetch_add(count, std::memory_order_relaxed);
+        m_busy.fetch_add(busy.count(), std::memory_order_relaxed);
+        m_blocked.fetch_add(blocked.count(), std::memory_order_relaxed);
+    }
+
+    void addExpired() noexcept
+    {
+        m_expired.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void addError() noexcept
+    {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] FilterMetrics load() const noexcept
+    {
+        FilterMetrics metrics;
+        metrics.counter = m_counter.load(std::memory_order_relaxed);
+        metrics.wallTime =
+            Clock::duration(m_busy.load(std::memory_order_relaxed));
+        metrics.blockedTime =
+            Clock::duration(m_blocked.load(std::memory_order_relaxed));
+        metrics.expired = m_expired.load(std::memory_order_relaxed);
+        metrics.errors  = m_errors.load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+    void reset() noexcept
+    {
+        m_counter.store(0, std::memory_order_relaxed);
+        m_busy.store(0, std::memory_order_relaxed);
+        m_blocked.store(0, std::memory_order_relaxed);
+        m_expired.store(0, std::memory_order_relaxed);
+        m_errors.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> m_counter{0};
+    std::atomic<Clock::rep> m_busy{0};
+    std::atomic<Clock::rep> m_blocked{0};
+    std::atomic<uint32_t> m_expired{0};
+    std::atomic<uint32_t> m_errors{0};
+};
+
+} // namespace detail
+
+} // namespace blpl
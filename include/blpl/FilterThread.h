@@ -1,13 +1,24 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
 
 #include "AbstractFilterThread.h"
 #include "AbstractPipe.h"
+#include "Deadline.h"
 #include "Filter.h"
+#include "FilterError.h"
+#include "FilterMetrics.h"
 #include "Pipe.h"
+#include "Tracer.h"
 
 namespace blpl {
 
@@ -19,6 +30,17 @@ namespace blpl {
  * works on its incoming data sequentially. By using this on all filters of the
  * pipeline, the pipeline can work on all stages in parallel while the
  * individual stages don't have to be threadsafe.
+ *
+ * Elements whose deadline has passed, see DeadlineOf, are skipped and counted
+ * in the metrics instead of being processed. An exception thrown while
+ * handling an element drops the element and is counted and handed to the
+ * error handler, see setErrorHandler(), while the thread goes on with the next
+ * one.
+ *
+ * In pull mode, see setPullMode(), the thread sleeps until results are
+ * requested from its out pipe. It then processes the input in its in pipe, or
+ * requests input from there and answers from the cache of the last result
+ * meanwhile, if caching is enabled.
  */
 template <class InData, class OutData>
 class FilterThread : public AbstractFilterThread
@@ -36,8 +58,41 @@ public:
     void stop() noexcept override;
     void reset() noexcept override;
 
+    [[nodiscard]] FilterMetrics metrics() const noexcept override
+    {
+        return m_metrics.load();
+    }
+    void resetMetrics() noexcept override
+    {
+        m_metrics.reset();
+    }
+
+    bool
+    replaceFilter(std::shared_ptr<AbstractFilter> filter) noexcept override;
+
+    bool pause() noexcept override;
+    void resume() noexcept override;
+
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point>
+    processingSince() const noexcept override;
+
+    bool setErrorHandler(
+        std::function<void(FilterError&&)> handler) noexcept override;
+
+    bool setPullMode(bool pull) noexcept override;
+    bool setCaching(bool caching) noexcept override;
+
 private:
     void run();
+    void processNext() noexcept;
+    void reportError(uint64_t sequence, std::exception_ptr exception) noexcept;
+    bool hasDemandedInput() const noexcept;
+    bool isWanted() const noexcept;
+    void awaitDemand();
+    void pushCached() noexcept;
+    void wakeUp() noexcept;
+    void resetFilter(uint32_t stages, bool processPending) noexcept;
+    uint32_t traceTrack();
 
 private:
     std::shared_ptr<Pipe<InData>> m_inPipe;
@@ -48,6 +103,45 @@ private:
     volatile bool m_bFiltering;
     std::thread m_thread;
     std::mutex m_mutex;
+    /// held while the filter processes an element
+    std::mutex m_filterMutex;
+    std::atomic<bool> m_paused{false};
+    /// set from taking an element until it was handed on
+    std::atomic<bool> m_busy{false};
+    /// clock ticks at which process() was called, 0 while idle
+    std::atomic<detail::MetricsCounters::Clock::rep> m_processingSince{0};
+    /// number of elements taken from the in pipe, only used by the thread
+    uint64_t m_sequence = 0;
+    /// guarded by m_filterMutex
+    std::function<void(FilterError&&)> m_errorHandler;
+
+    /// the thread sleeps on it in pull mode while nothing is requested
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_caching = false;
+    /// last result if caching, only used by the thread
+    std::optional<OutData> m_cache;
+
+    uint32_t m_traceTrack = 0;
+    detail::MetricsCounters m_metrics;
+};
+
+/**
+ * @brief Selects the class that drives a filter of type FilterType in a
+ * Pipeline. This is FilterThread, unless the filter names a different one in a
+ * member type called threadType, which has to be constructible from the in
+ * pipe, the filter and the out pipe just like FilterThread.
+ */
+template <class FilterType, class = void>
+struct FilterThreadType
+{
+    using type =
+        FilterThread<typename FilterType::inType, typename FilterType::outType>;
+};
+template <class FilterType>
+struct FilterThreadType<FilterType, std::void_t<typename FilterType::threadType>>
+{
+    using type = typename FilterType::threadType;
 };
 
 /**
@@ -72,6 +166,7 @@ FilterThread<InData, OutData>::FilterThread(
     , m_bFiltering(false)
 {
     m_inPipe->registerPushCallback([this] { start(); });
+    m_outPipe->registerDemandCallback([this] { start(); });
 }
 
 /**
@@ -112,6 +207,8 @@ void FilterThread<InData, OutData>::start() noexcept
         m_bFilterThreadActive = true;
 
         m_thread = std::thread(&FilterThread<InData, OutData>::run, this);
+    } else {
+        wakeUp();
     }
 }
 
@@ -128,6 +225,7 @@ void FilterThread<InData, OutData>::stop() noexcept
 
     m_bFiltering          = false;
     m_bFilterThreadActive = false;
+    wakeUp();
 
     if (m_thread.joinable())
         m_thread.join();
@@ -144,12 +242,102 @@ void FilterThread<InData, OutData>::reset() noexcept
     if (stopAndRestart) {
         stop();
     }
-    m_filter->reset();
+    {
+        std::scoped_lock<std::mutex> lock(m_filterMutex);
+        m_filter->reset();
+    }
     if (stopAndRestart) {
         start();
     }
 }
 
+/**
+ * @brief Replaces the filter between two elements without stopping the thread.
+ * Waits for the element currently in process, while incoming data waits in the
+ * in pipe.
+ *
+ * @return False if the filter is not a Filter<InData, OutData>.
+ */
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::replaceFilter(
+    std::shared_ptr<AbstractFilter> filter) noexcept
+{
+    auto typed = std::dynamic_pointer_cast<Filter<InData, OutData>>(filter);
+    if (!typed)
+        return false;
+
+    std::scoped_lock<std::mutex> lock(m_filterMutex);
+    m_filter = std::move(typed);
+
+    return true;
+}
+
+/**
+ * @brief Keeps the thread from taking elements, e.g. for a checkpoint of the
+ * pipeline, and waits until the element in process was pushed into the out
+ * pipe.
+ */
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::pause() noexcept
+{
+    m_paused = true;
+    while (m_busy)
+        std::this_thread::yield();
+
+    return true;
+}
+
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::resume() noexcept
+{
+    m_paused = false;
+}
+
+template <class InData, class OutData>
+std::optional<std::chrono::steady_clock::time_point>
+FilterThread<InData, OutData>::processingSince() const noexcept
+{
+    using Clock = detail::MetricsCounters::Clock;
+    auto since  = m_processingSince.load(std::memory_order_relaxed);
+    if (since == 0)
+        return std::nullopt;
+    return Clock::time_point(Clock::duration(since));
+}
+
+/**
+ * @brief Switches the in and out pipe to pull mode, or both back.
+ */
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::setPullMode(bool pull) noexcept
+{
+    m_inPipe->setPullMode(pull);
+    m_outPipe->setPullMode(pull);
+
+    return true;
+}
+
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::setCaching(bool caching) noexcept
+{
+    if constexpr (std::is_copy_constructible<OutData>::value) {
+        m_caching = caching;
+        m_cache.reset();
+        return true;
+    } else {
+        return !caching;
+    }
+}
+
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::setErrorHandler(
+    std::function<void(FilterError&&)> handler) noexcept
+{
+    std::scoped_lock<std::mutex> lock(m_filterMutex);
+    m_errorHandler = std::move(handler);
+
+    return true;
+}
+
 /**
  * @brief Method that is called by the thread, waits for input data and calls
  * the filters process method.
@@ -157,17 +345,213 @@ void FilterThread<InData, OutData>::reset() noexcept
 template <class InData, class OutData>
 void FilterThread<InData, OutData>::run()
 {
+    if (Tracer::isEnabled())
+        Tracer::setTrack(traceTrack());
+
     do {
         std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
         if (lock.try_lock()) {
-            if (m_inPipe->size() < 1) {
+            if (m_inPipe->size() < 1 && !m_outPipe->isPullMode()) {
                 m_bFilterThreadActive = false;
+            } else if (m_inPipe->size() < 1 || !hasDemandedInput()) {
+                lock.unlock();
+                awaitDemand();
             } else {
                 lock.unlock();
-                m_outPipe->push(m_filter->process(m_inPipe->pop()));
+                // announce the element before checking for a pause, so pause()
+                // either sees it or keeps the thread from taking it
+                m_busy = true;
+                if (m_paused) {
+                    m_busy = false;
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // the pipe might have been reset in the meantime
+                bool processPending = true;
+                if (uint32_t stages =
+                        m_inPipe->takeResetMarker(processPending)) {
+                    resetFilter(stages, processPending);
+                } else if (m_outPipe->isDemanded()) {
+                    processNext();
+                }
+                m_busy = false;
             }
         }
     } while (m_bFilterThreadActive);
+
+    m_outPipe->flush();
+}
+
+/**
+ * @brief Takes the next element from the in pipe, processes it and pushes the
+ * result into the out pipe. Exceptions are reported and drop the element.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::processNext() noexcept
+{
+    using Clock       = detail::MetricsCounters::Clock;
+    uint64_t sequence = m_sequence;
+    try {
+        auto in = m_inPipe->tryPop();
+        if (!in)
+            return;
+        ++m_sequence;
+        if (isExpired(*in)) {
+            m_metrics.addExpired();
+            return;
+        }
+
+        std::unique_lock<std::mutex> filterLock(m_filterMutex);
+        auto begin = Clock::now();
+        m_processingSince.store(begin.time_since_epoch().count(),
+                                std::memory_order_relaxed);
+        auto out  = m_filter->process(std::move(*in));
+        auto done = Clock::now();
+        m_processingSince.store(0, std::memory_order_relaxed);
+        filterLock.unlock();
+
+        if constexpr (std::is_copy_constructible<OutData>::value) {
+            if (m_caching)
+                m_cache.emplace(out);
+        }
+        m_outPipe->push(std::move(out));
+        m_metrics.add(done - begin, Clock::now() - done);
+    } catch (...) {
+        m_processingSince.store(0, std::memory_order_relaxed);
+        // a throwing move out of the pipe has used up the element as well
+        m_sequence = sequence + 1;
+        reportError(sequence, std::current_exception());
+    }
+}
+
+/**
+ * @brief Counts an exception and hands it to the error handler, if any.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::reportError(
+    uint64_t sequence,
+    std::exception_ptr exception) noexcept
+{
+    m_metrics.addError();
+
+    FilterError error;
+    std::function<void(FilterError&&)> handler;
+    {
+        std::scoped_lock<std::mutex> lock(m_filterMutex);
+        if (!m_errorHandler)
+            return;
+        handler      = m_errorHandler;
+        error.filter = m_filter;
+    }
+    error.sequence  = sequence;
+    error.exception = std::move(exception);
+    try {
+        handler(std::move(error));
+    } catch (...) {
+        // the handler must not take the thread down
+    }
+}
+
+/**
+ * @brief Returns whether the next element in the in pipe may be taken, i.e. a
+ * result is requested or it is the reset marker.
+ */
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::hasDemandedInput() const noexcept
+{
+    return m_outPipe->isDemanded()
+           || (m_inPipe->hasResetMarker() && m_inPipe->size() == 1);
+}
+
+/**
+ * @brief Returns whether a thread in pull mode has to wake up, because there is
+ * input for a request or a request it hasn't passed on yet.
+ */
+template <class InData, class OutData>
+bool FilterThread<InData, OutData>::isWanted() const noexcept
+{
+    if (m_inPipe->size() > 0)
+        return hasDemandedInput();
+    return m_outPipe->demand() > m_inPipe->demand();
+}
+
+/**
+ * @brief Passes the requests on the out pipe on to the in pipe, answers them
+ * from the cache meanwhile and sleeps until the thread is wanted or stopped.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::awaitDemand()
+{
+    uint32_t demand = m_outPipe->demand();
+    uint32_t queued = m_inPipe->size();
+    if (demand > queued) {
+        m_inPipe->requestUpTo(demand - queued);
+        if (queued == 0)
+            pushCached();
+    }
+
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait(lock, [this] { return !m_bFilterThreadActive || isWanted(); });
+}
+
+/**
+ * @brief Pushes a copy of the last result, if there is one.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::pushCached() noexcept
+{
+    if constexpr (std::is_copy_constructible<OutData>::value) {
+        if (!m_cache)
+            return;
+
+        try {
+            m_outPipe->push(OutData(*m_cache));
+        } catch (...) {
+            reportError(m_sequence, std::current_exception());
+        }
+    }
+}
+
+/**
+ * @brief Wakes the thread if it sleeps in pull mode.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::wakeUp() noexcept
+{
+    std::scoped_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_all();
+}
+
+/**
+ * @brief Resets the filter when the reset marker reached it and hands the
+ * marker on to the next stage, if that has to be reset as well.
+ */
+template <class InData, class OutData>
+void FilterThread<InData, OutData>::resetFilter(uint32_t stages,
+                                                bool processPending) noexcept
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_filterMutex);
+        m_filter->reset();
+    }
+    if (stages > 1)
+        m_outPipe->pushResetMarker(stages - 1, processPending);
+}
+
+/**
+ * @brief Returns the track the events of this filter are shown on when
+ * tracing, registering it on first use. Only called by the filter thread.
+ */
+template <class InData, class OutData>
+uint32_t FilterThread<InData, OutData>::traceTrack()
+{
+    std::scoped_lock<std::mutex> lock(m_filterMutex);
+    if (m_traceTrack == 0)
+        m_traceTrack =
+            Tracer::registerTrack(Tracer::demangle(typeid(*m_filter).name()));
+
+    return m_traceTrack;
 }
 
 } // namespace blpl
@@ -1,34 +1,65 @@
 #pragma once
 
 #include <functional>
+#include <type_traits>
 
 #include "Filter.h"
 
 namespace blpl {
 
-template <class InData, class OutData>
+/**
+ * @brief A filter that calls a callable object for processing.
+ *
+ * The callable is stored by its concrete type and gets the input as rvalue, so
+ * it can move from it or return it by move without any copy of the payload.
+ * By default the callable is type-erased in a std::function, use
+ * makeFunctorFilter() to store a lambda without that indirection.
+ *
+ * @tparam Func Type of the callable, has to be invocable with InData&& and
+ * return something convertible to OutData.
+ */
+template <class InData,
+          class OutData,
+          class Func = std::function<OutData(InData&&)>>
 class FunctorFilter : public Filter<InData, OutData>
 {
+    static_assert(std::is_invocable_r<OutData, Func&, InData&&>::value,
+                  "Functor has to be callable with InData&& and return OutData");
+
 public:
-    FunctorFilter(std::function<OutData(InData&&)> filterFunc);
+    FunctorFilter(Func filterFunc);
 
 protected:
     OutData processImpl(InData&& in) override;
 
 private:
-    std::function<OutData(InData)> m_filterFunc;
+    Func m_filterFunc;
 };
 
-template <class InData, class OutData>
-FunctorFilter<InData, OutData>::FunctorFilter(
-    std::function<OutData(InData&&)> filterFunc)
-    : m_filterFunc(filterFunc)
+template <class InData, class OutData, class Func>
+FunctorFilter<InData, OutData, Func>::FunctorFilter(Func filterFunc)
+    : m_filterFunc(std::move(filterFunc))
 {}
 
-template <class InData, class OutData>
-OutData FunctorFilter<InData, OutData>::processImpl(InData&& in)
+template <class InData, class OutData, class Func>
+OutData FunctorFilter<InData, OutData, Func>::processImpl(InData&& in)
+{
+    return std::invoke(m_filterFunc, std::move(in));
+}
+
+/**
+ * @brief Creates a FunctorFilter that stores the given callable by its concrete
+ * type. The OutData is deduced from the return type of the callable.
+ *
+ * @tparam InData The datatype that is consumed by the filter.
+ */
+template <class InData, class Func>
+FunctorFilter<InData,
+              std::decay_t<std::invoke_result_t<Func&, InData&&>>,
+              std::decay_t<Func>>
+makeFunctorFilter(Func&& filterFunc)
 {
-    return m_filterFunc(in);
+    return {std::forward<Func>(filterFunc)};
 }
 
 } // namespace blpl
@@ -0,0 +1,325 @@
+#pragma once
+
+#if !defined(__linux__)
+#error "IoExecutor is only implemented on top of epoll on Linux"
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace blpl {
+
+/**
+ * @brief An event loop that runs callbacks on a small, fixed number of threads
+ * once file descriptors become ready.
+ *
+ * This is the driver behind CoroutineFilter: instead of blocking a whole
+ * thread while waiting for a disk read or a socket, a filter registers the
+ * file descriptor here and its continuation gets executed by one of the
+ * executor threads once the descriptor is ready. That way a handful of threads
+ * can serve many I/O-bound filters.
+ *
+ * Every file descriptor can have at most one pending read and one pending
+ * write callback at a time. Each callback is called exactly once. Regular files
+ * are always ready, their callbacks are posted right away.
+ */
+class IoExecutor
+{
+public:
+    explicit IoExecutor(size_t numThreads = 1);
+    ~IoExecutor();
+
+    IoExecutor(const IoExecutor&) = delete;
+    IoExecutor& operator=(const IoExecutor&) = delete;
+
+    /**
+     * @brief Executes the given task on one of the executor threads.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Executes the callback on one of the executor threads as soon as
+     * fd is readable (or in an error state).
+     *
+     * @throws std::system_error if fd can't be watched, e.g. because it is no
+     * valid file descriptor.
+     */
+    void whenReadable(int fd, std::function<void()> callback);
+
+    /**
+     * @brief Executes the callback on one of the executor threads as soon as
+     * fd is writable (or in an error state).
+     *
+     * @throws std::system_error if fd can't be watched.
+     */
+    void whenWritable(int fd, std::function<void()> callback);
+
+    [[nodiscard]] size_t numThreads() const noexcept
+    {
+        return m_threads.size();
+    }
+
+    /**
+     * @brief Returns the executor that is shared by all filters that don't get
+     * one explicitly. It is created with two threads on first use.
+     */
+    static std::shared_ptr<IoExecutor> defaultExecutor();
+
+private:
+    struct Waiters
+    {
+        std::function<void()> onReadable;
+        std::function<void()> onWritable;
+    };
+
+    void run();
+    void wakeUp() noexcept;
+    void runPostedTasks();
+    void dispatch(int fd, uint32_t events);
+    void addWaiter(int fd,
+                   std::function<void()> Waiters::*waiter,
+                   std::function<void()> callback);
+    int arm(int fd, const Waiters& waiters);
+
+private:
+    int m_epollFd;
+    int m_wakeUpFd;
+    std::atomic<bool> m_stopping;
+
+    std::mutex m_mutex;
+    std::deque<std::function<void()>> m_tasks;
+    std::unordered_map<int, Waiters> m_waiters;
+
+    std::vector<std::thread> m_threads;
+};
+
+/**
+ * @brief Constructor, starts the executor threads.
+ */
+inline IoExecutor::IoExecutor(size_t numThreads)
+    : m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+    , m_wakeUpFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_stopping(false)
+{
+    epoll_event event{};
+    event.events  = EPOLLIN;
+    event.data.fd = m_wakeUpFd;
+    if (m_epollFd < 0 || m_wakeUpFd < 0 ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeUpFd, &event) != 0) {
+        int error = errno;
+        if (m_wakeUpFd >= 0)
+            close(m_wakeUpFd);
+        if (m_epollFd >= 0)
+            close(m_epollFd);
+        throw std::system_error(error, std::generic_category(), "IoExecutor");
+    }
+
+    if (numThreads < 1)
+        numThreads = 1;
+    for (size_t i = 0; i < numThreads; ++i)
+        m_threads.emplace_back(&IoExecutor::run, this);
+}
+
+/**
+ * @brief Destructor, stops and joins the executor threads. Pending callbacks
+ * are not executed.
+ */
+inline IoExecutor::~IoExecutor()
+{
+    m_stopping = true;
+    wakeUp();
+    for (auto& thread : m_threads)
+        thread.join();
+
+    close(m_wakeUpFd);
+    close(m_epollFd);
+}
+
+inline void IoExecutor::post(std::function<void()> task)
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    wakeUp();
+}
+
+inline void IoExecutor::whenReadable(int fd, std::function<void()> callback)
+{
+    addWaiter(fd, &Waiters::onReadable, std::move(callback));
+}
+
+inline void IoExecutor::whenWritable(int fd, std::function<void()> callback)
+{
+    addWaiter(fd, &Waiters::onWritable, std::move(callback));
+}
+
+inline std::shared_ptr<IoExecutor> IoExecutor::defaultExecutor()
+{
+    static auto executor = std::make_shared<IoExecutor>(2);
+    return executor;
+}
+
+/**
+ * @brief Sets callback as the given waiter of fd and arms fd for it. epoll
+ * refuses regular files with EPERM, they are always ready, so their waiters
+ * are posted instead.
+ */
+inline void IoExecutor::addWaiter(int fd,
+                                  std::function<void()> Waiters::*waiter,
+                                  std::function<void()> callback)
+{
+    Waiters ready;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        auto it            = m_waiters.try_emplace(fd).first;
+        it->second.*waiter = std::move(callback);
+
+        int error = arm(fd, it->second);
+        if (error == 0)
+            return;
+        if (error != EPERM) {
+            it->second.*waiter = nullptr;
+            if (!it->second.onReadable && !it->second.onWritable)
+                m_waiters.erase(it);
+            throw std::system_error(
+                error, std::generic_category(), "epoll_ctl");
+        }
+
+        ready = std::move(it->second);
+        m_waiters.erase(it);
+    }
+
+    if (ready.onReadable)
+        post(std::move(ready.onReadable));
+    if (ready.onWritable)
+        post(std::move(ready.onWritable));
+}
+
+/**
+ * @brief (Re-)registers fd with epoll for the events there are waiters for.
+ * Needs m_mutex to be locked.
+ *
+ * @return 0 on success, the errno of epoll_ctl otherwise.
+ */
+inline int IoExecutor::arm(int fd, const Waiters& waiters)
+{
+    epoll_event event{};
+    event.events  = EPOLLONESHOT;
+    event.data.fd = fd;
+    if (waiters.onReadable)
+        event.events |= EPOLLIN;
+    if (waiters.onWritable)
+        event.events |= EPOLLOUT;
+
+    // a closed fd is removed from the epoll set automatically, so we can't
+    // know whether fd is still registered
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event) == 0)
+        return 0;
+    if (errno == ENOENT && epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == 0)
+        return 0;
+
+    return errno;
+}
+
+inline void IoExecutor::wakeUp() noexcept
+{
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = write(m_wakeUpFd, &one, sizeof(one));
+}
+
+/**
+ * @brief The loop of every executor thread.
+ */
+inline void IoExecutor::run()
+{
+    constexpr int maxEvents = 64;
+    epoll_event events[maxEvents];
+
+    while (!m_stopping) {
+        int numEvents = epoll_wait(m_epollFd, events, maxEvents, -1);
+
+        for (int i = 0; i < numEvents && !m_stopping; ++i) {
+            if (events[i].data.fd == m_wakeUpFd)
+                runPostedTasks();
+            else
+                dispatch(events[i].data.fd, events[i].events);
+        }
+    }
+
+    // wake up the next thread
+    wakeUp();
+}
+
+inline void IoExecutor::runPostedTasks()
+{
+    uint64_t count;
+    [[maybe_unused]] auto read = ::read(m_wakeUpFd, &count, sizeof(count));
+
+    while (!m_stopping) {
+        std::function<void()> task;
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/**
+ * @brief Calls the waiters of fd that are satisfied by the given events and
+ * re-arms fd for the remaining ones.
+ */
+inline void IoExecutor::dispatch(int fd, uint32_t events)
+{
+    const bool error = events & (EPOLLERR | EPOLLHUP);
+    std::function<void()> onReadable;
+    std::function<void()> onWritable;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        auto it = m_waiters.find(fd);
+        if (it == m_waiters.end())
+            return;
+
+        auto& waiters = it->second;
+        if (error || (events & EPOLLIN))
+            onReadable = std::exchange(waiters.onReadable, nullptr);
+        if (error || (events & EPOLLOUT))
+            onWritable = std::exchange(waiters.onWritable, nullptr);
+
+        // re-arm for a waiter that wasn't satisfied by this event, one that
+        // can't be re-armed is called right away
+        bool pending = waiters.onReadable || waiters.onWritable;
+        if (!pending || arm(fd, waiters) != 0) {
+            if (waiters.onReadable)
+                onReadable = std::move(waiters.onReadable);
+            if (waiters.onWritable)
+                onWritable = std::move(waiters.onWritable);
+            m_waiters.erase(it);
+        }
+    }
+
+    if (onReadable)
+        onReadable();
+    if (onWritable)
+        onWritable();
+}
+
+} // namespace blpl
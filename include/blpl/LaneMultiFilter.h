@@ -0,0 +1,453 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "AbstractFilterThread.h"
+#include "Deadline.h"
+#include "FilterError.h"
+#include "FilterMetrics.h"
+#include "Generator.h"
+#include "MultiFilter.h"
+#include "Pipe.h"
+#include "Tracer.h"
+
+namespace blpl {
+
+template <class InData, class OutData>
+class LaneMultiFilterThread;
+
+/**
+ * @brief MultiFilter whose sub-filters advance independently of each other
+ * when run in a pipeline.
+ *
+ * Each sub-filter (lane) gets its own thread and queue, so a lane can start on
+ * the next element while the others are still busy with the previous one.
+ * Lanes may run ahead of the slowest one by up to maxSkew elements, the
+ * results are collected into vectors again in the order the inputs arrived.
+ * Throughput is thus limited by the average cost of the lanes instead of the
+ * maximum per element.
+ *
+ * Called directly via process(), it behaves like a MultiFilter in lockstep.
+ */
+template <class InData, class OutData>
+class LaneMultiFilter : public MultiFilter<InData, OutData>
+{
+public:
+    using threadType = LaneMultiFilterThread<InData, OutData>;
+
+    /**
+     * @param lanes MultiFilter with the sub-filters, e.g. built with operator&.
+     * @param maxSkew Number of elements the fastest lane may be ahead of the
+     * slowest one.
+     */
+    explicit LaneMultiFilter(const MultiFilter<InData, OutData>& lanes,
+                             size_t maxSkew = 4)
+        : MultiFilter<InData, OutData>(lanes)
+        , m_maxSkew(maxSkew > 0 ? maxSkew : 1)
+    {}
+
+    [[nodiscard]] size_t maxSkew() const noexcept
+    {
+        return m_maxSkew;
+    }
+
+private:
+    size_t m_maxSkew;
+};
+
+/**
+ * @brief Drives a LaneMultiFilter in a pipeline: one thread hands out the
+ * elements of the incoming vectors to the lanes, one thread per lane processes
+ * them and one thread joins the results and pushes them on.
+ *
+ * In contrast to FilterThread the threads stay alive between start() and
+ * stop() and sleep on a condition variable while there is nothing to do.
+ *
+ * Expired vectors, see DeadlineOf, are skipped before they reach the lanes. If
+ * a lane throws, the vector its element belongs to is dropped and the first
+ * exception is reported like in FilterThread.
+ */
+template <class InData, class OutData>
+class LaneMultiFilterThread : public AbstractFilterThread
+{
+public:
+    LaneMultiFilterThread(
+        std::shared_ptr<Pipe<std::vector<InData>>> inPipe,
+        std::shared_ptr<LaneMultiFilter<InData, OutData>> filter,
+        std::shared_ptr<Pipe<std::vector<OutData>>> outPipe)
+        : m_inPipe(std::move(inPipe))
+        , m_filter(std::move(filter))
+        , m_outPipe(std::move(outPipe))
+        , m_lanes(m_filter->numParallel())
+    {
+        m_inPipe->registerPushCallback([this] { start(); });
+    }
+
+    ~LaneMultiFilterThread() override
+    {
+        stop();
+    }
+
+    void start() noexcept override;
+    void stop() noexcept override;
+    void reset() noexcept override;
+
+    /**
+     * @brief The counter is the number of joined vectors, the wall time the
+     * average busy time of the lanes.
+     */
+    [[nodiscard]] FilterMetrics metrics() const noexcept override
+    {
+        return m_metrics.load();
+    }
+    void resetMetrics() noexcept override
+    {
+        m_metrics.reset();
+    }
+
+    bool setErrorHandler(
+        std::function<void(FilterError&&)> handler) noexcept override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_errorHandler = std::move(handler);
+
+        return true;
+    }
+
+private:
+    void dispatch();
+    bool resetLanes();
+    void runLane(size_t lane);
+    void join();
+    void reportError(uint64_t sequence, std::exception_ptr exception) noexcept;
+
+    /// the result of a lane for one element, or the exception it threw
+    struct LaneResult
+    {
+        std::optional<OutData> out;
+        std::exception_ptr error;
+    };
+
+    struct Lane
+    {
+        std::deque<InData> inputs;
+        std::deque<LaneResult> results;
+    };
+
+private:
+    std::shared_ptr<Pipe<std::vector<InData>>> m_inPipe;
+    std::shared_ptr<LaneMultiFilter<InData, OutData>> m_filter;
+    std::shared_ptr<Pipe<std::vector<OutData>>> m_outPipe;
+
+    /// guards the lanes and the flags below
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<Lane> m_lanes;
+    size_t m_inFlight   = 0;
+    bool m_running      = false;
+    bool m_inputPending = false;
+    std::function<void(FilterError&&)> m_errorHandler;
+
+    /// sequence numbers of the vectors in flight, guarded by m_mutex
+    std::deque<uint64_t> m_sequences;
+    /// number of vectors taken from the in pipe, only used by dispatch()
+    uint64_t m_sequence = 0;
+
+    /// serializes start() and stop()
+    std::mutex m_controlMutex;
+    std::vector<std::thread> m_threads;
+
+    detail::MetricsCounters m_metrics;
+};
+
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::start() noexcept
+{
+    std::scoped_lock<std::mutex> control(m_controlMutex);
+    m_inPipe->enable();
+    m_outPipe->enable();
+
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_inputPending = true;
+        if (m_running) {
+            m_changed.notify_all();
+            return;
+        }
+        m_running = true;
+    }
+
+    m_threads.emplace_back(&LaneMultiFilterThread::dispatch, this);
+    for (size_t i = 0; i < m_lanes.size(); ++i)
+        m_threads.emplace_back(&LaneMultiFilterThread::runLane, this, i);
+    m_threads.emplace_back(&LaneMultiFilterThread::join, this);
+}
+
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::stop() noexcept
+{
+    std::scoped_lock<std::mutex> control(m_controlMutex);
+    m_inPipe->reset();
+    m_inPipe->disable();
+    m_outPipe->disable();
+
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_changed.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+
+    // drop everything that is still in flight
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    for (auto& lane : m_lanes) {
+        lane.inputs.clear();
+        lane.results.clear();
+    }
+    m_sequences.clear();
+    m_inFlight = 0;
+}
+
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::reset() noexcept
+{
+    bool restart;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        restart = m_running;
+    }
+
+    if (restart)
+        stop();
+    m_filter->reset();
+    if (restart)
+        start();
+}
+
+/**
+ * @brief Waits until the elements in flight are pushed on and resets the
+ * sub-filters. Returns false if the thread got stopped in the meantime.
+ */
+template <class InData, class OutData>
+bool LaneMultiFilterThread<InData, OutData>::resetLanes()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return m_inFlight == 0 || !m_running; });
+    if (!m_running)
+        return false;
+
+    // the lanes are idle without inputs
+    m_filter->reset();
+    return true;
+}
+
+/**
+ * @brief Takes the vectors out of the in pipe and hands their elements to the
+ * lanes, waiting while the slowest lane is maxSkew elements behind. Reset
+ * markers are handled once all elements ahead of them are pushed on.
+ */
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::dispatch()
+{
+    const size_t numLanes = m_lanes.size();
+    const size_t maxSkew  = m_filter->maxSkew();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock,
+                           [this] { return m_inputPending || !m_running; });
+            if (!m_running)
+                return;
+            m_inputPending = false;
+        }
+
+        while (true) {
+            bool processPending = true;
+            if (uint32_t stages = m_inPipe->takeResetMarker(processPending)) {
+                if (!resetLanes())
+                    return;
+                if (stages > 1)
+                    m_outPipe->pushResetMarker(stages - 1, processPending);
+                continue;
+            }
+
+            auto in = m_inPipe->tryPop();
+            if (!in)
+                break;
+            uint64_t sequence = m_sequence++;
+            if (isExpired(*in)) {
+                m_metrics.addExpired();
+                continue;
+            }
+            if constexpr (std::is_same<InData, Generator>())
+                in->resize(numLanes);
+            // incomplete inputs are dropped, like in lockstep
+            if (in->size() < numLanes)
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this, maxSkew] {
+                return m_inFlight < maxSkew || !m_running;
+            });
+            if (!m_running)
+                return;
+
+            for (size_t i = 0; i < numLanes; ++i)
+                m_lanes[i].inputs.push_back(std::move((*in)[i]));
+            m_sequences.push_back(sequence);
+            ++m_inFlight;
+            lock.unlock();
+            m_changed.notify_all();
+        }
+    }
+}
+
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::runLane(size_t i)
+{
+    using Clock  = detail::MetricsCounters::Clock;
+    auto& filter = m_filter->filters()[i];
+    auto& lane   = m_lanes[i];
+
+    if (Tracer::isEnabled())
+        Tracer::setTrack(
+            Tracer::registerTrack(Tracer::demangle(typeid(*m_filter).name()) +
+                                  " lane " + std::to_string(i)));
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(
+            lock, [this, &lane] { return !lane.inputs.empty() || !m_running; });
+        if (!m_running)
+            return;
+
+        InData in = std::move(lane.inputs.front());
+        lane.inputs.pop_front();
+        lock.unlock();
+
+        LaneResult result;
+        auto begin = Clock::now();
+        try {
+            result.out.emplace(filter->process(std::move(in)));
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+        auto busy = Clock::now() - begin;
+
+        lock.lock();
+        lane.results.push_back(std::move(result));
+        lock.unlock();
+        m_changed.notify_all();
+
+        m_metrics.add(busy / m_lanes.size(), Clock::duration::zero(), 0);
+    }
+}
+
+/**
+ * @brief Collects the results of all lanes for the oldest element in flight
+ * and pushes them on as one vector.
+ */
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::join()
+{
+    using Clock = detail::MetricsCounters::Clock;
+
+    auto complete = [this] {
+        for (auto& lane : m_lanes) {
+            if (lane.results.empty())
+                return false;
+        }
+        return true;
+    };
+
+    while (true) {
+        std::vector<OutData> out;
+        out.reserve(m_lanes.size());
+        std::exception_ptr error;
+        uint64_t sequence;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [&] { return complete() || !m_running; });
+            if (!m_running)
+                return;
+
+            sequence = m_sequences.front();
+            m_sequences.pop_front();
+
+            for (auto& lane : m_lanes) {
+                auto& result = lane.results.front();
+                if (!error && result.error)
+                    error = result.error;
+                else if (!error)
+                    out.push_back(std::move(*result.out));
+                lane.results.pop_front();
+            }
+        }
+
+        if (!error) {
+            try {
+                auto begin = Clock::now();
+                m_outPipe->push(std::move(out));
+                m_metrics.add(Clock::duration::zero(), Clock::now() - begin);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        if (error)
+            reportError(sequence, std::move(error));
+
+        bool idle;
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            idle = --m_inFlight == 0;
+        }
+        m_changed.notify_all();
+
+        if (idle)
+            m_outPipe->flush();
+    }
+}
+
+/**
+ * @brief Counts an exception and hands it to the error handler, if any.
+ */
+template <class InData, class OutData>
+void LaneMultiFilterThread<InData, OutData>::reportError(
+    uint64_t sequence,
+    std::exception_ptr exception) noexcept
+{
+    m_metrics.addError();
+
+    FilterError error;
+    std::function<void(FilterError&&)> handler;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        if (!m_errorHandler)
+            return;
+        handler = m_errorHandler;
+    }
+    error.sequence  = sequence;
+    error.filter    = m_filter;
+    error.exception = std::move(exception);
+    try {
+        handler(std::move(error));
+    } catch (...) {
+        // the handler must not take the thread down
+    }
+}
+
+} // namespace blpl
@@ -0,0 +1,179 @@
+#pragma once
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "MappedRecordSource is only implemented for POSIX systems"
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Filter.h"
+#include "Generator.h"
+#include "RecordView.h"
+
+namespace blpl {
+
+namespace detail {
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        m_open = true;
+
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            void* data = mmap(nullptr,
+                              static_cast<size_t>(status.st_size),
+                              PROT_READ,
+                              MAP_PRIVATE,
+                              fd,
+                              0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const std::byte*>(data);
+                m_size = static_cast<size_t>(status.st_size);
+                // we read front to back, let the kernel read ahead
+                madvise(data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (m_data)
+            munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_open;
+    }
+    [[nodiscard]] const std::byte* data() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+private:
+    const std::byte* m_data = nullptr;
+    size_t m_size           = 0;
+    bool m_open             = false;
+};
+
+} // namespace detail
+
+/**
+ * @brief Source filter that memory maps a file and streams the records in it
+ * as RecordViews without copying them.
+ *
+ * Records either have a fixed size or are prefixed by their length as a
+ * std::uint32_t in host byte order (see RecordFileSink). Once all records have
+ * been handed out, the filter produces empty views. A truncated record at the
+ * end of the file is ignored, an empty record ends the stream.
+ *
+ * The views point into the mapping, which lives as long as the filter and all
+ * its copies. Make sure the pipeline is stopped before destroying the filter.
+ */
+class MappedRecordSource : public Filter<Generator, RecordView>
+{
+public:
+    /**
+     * @brief Constructs a source for a file of records of recordSize bytes.
+     */
+    MappedRecordSource(const std::string& path, size_t recordSize)
+        : m_file(std::make_shared<detail::MappedFile>(path))
+        , m_recordSize(recordSize)
+    {}
+
+    /**
+     * @brief Constructs a source for a file of length-prefixed records.
+     */
+    explicit MappedRecordSource(const std::string& path)
+        : MappedRecordSource(path, 0)
+    {}
+
+    /**
+     * @brief Returns false if the file could not be opened.
+     */
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_file->isOpen();
+    }
+
+    /**
+     * @brief Returns whether all records have been handed out.
+     */
+    [[nodiscard]] bool atEnd() const noexcept
+    {
+        return nextRecordSize() == 0;
+    }
+
+    /**
+     * @brief Starts over at the first record.
+     */
+    void reset() override
+    {
+        m_offset = 0;
+    }
+
+protected:
+    RecordView processImpl(Generator&&) override
+    {
+        size_t size = nextRecordSize();
+        if (size == 0)
+            return {};
+
+        size_t headerSize = m_recordSize > 0 ? 0 : sizeof(std::uint32_t);
+        RecordView record(m_file->data() + m_offset + headerSize, size);
+        m_offset += headerSize + size;
+
+        return record;
+    }
+
+private:
+    /**
+     * @brief Returns the size of the record at the current offset or 0 if
+     * there is no complete record left.
+     */
+    size_t nextRecordSize() const noexcept
+    {
+        size_t remaining = m_file->size() - m_offset;
+        if (m_recordSize > 0)
+            return remaining >= m_recordSize ? m_recordSize : 0;
+
+        std::uint32_t size;
+        if (remaining < sizeof(size))
+            return 0;
+        std::memcpy(&size, m_file->data() + m_offset, sizeof(size));
+
+        return remaining - sizeof(size) >= size ? size : 0;
+    }
+
+private:
+    std::shared_ptr<const detail::MappedFile> m_file;
+    size_t m_recordSize;
+    size_t m_offset = 0;
+};
+
+} // namespace blpl
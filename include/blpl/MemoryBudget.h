@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace blpl {
+
+/**
+ * @brief Estimates the memory held by a payload, used by pipes to account the
+ * bytes in flight when the pipeline has a MemoryBudget.
+ *
+ * By default this is the size of the object itself. Specialize it for payloads
+ * that own heap memory.
+ */
+template <class T, class = void>
+struct PayloadSize
+{
+    static size_t of(const T&) noexcept
+    {
+        return sizeof(T);
+    }
+};
+
+template <class T>
+struct PayloadSize<std::vector<T>>
+{
+    static size_t of(const std::vector<T>& vector) noexcept
+    {
+        // the unused capacity plus what the elements hold
+        size_t bytes = sizeof(vector);
+        bytes += (vector.capacity() - vector.size()) * sizeof(T);
+        for (auto& elem : vector)
+            bytes += PayloadSize<T>::of(elem);
+        return bytes;
+    }
+};
+
+template <>
+struct PayloadSize<std::string>
+{
+    static size_t of(const std::string& string) noexcept
+    {
+        return sizeof(string) + string.capacity();
+    }
+};
+
+/**
+ * @brief What producers feeding a pipeline do while it is over its budget.
+ */
+enum class BudgetPolicy
+{
+    /// wait until the pipeline drained enough
+    Block,
+    /// drop the element and count it
+    Drop
+};
+
+/**
+ * @brief Counts the payload bytes in the pipes of a pipeline and limits how
+ * many the producers at its entry may push.
+ *
+ * Only the entry of the pipeline enforces the limit, the stages inside always
+ * hand their results on, so elements in flight can always drain. The limit is
+ * soft: an element is admitted while the pipeline is empty, even if it exceeds
+ * the limit by itself, and concurrent producers may overshoot it by one element
+ * each.
+ */
+class MemoryBudget
+{
+public:
+    /**
+     * @param limit Maximum number of bytes in flight, 0 for no limit.
+     */
+    explicit MemoryBudget(size_t limit        = 0,
+                          BudgetPolicy policy = BudgetPolicy::Block) noexcept
+        : m_limit(limit)
+        , m_policy(policy)
+    {}
+
+    [[nodiscard]] size_t limit() const noexcept
+    {
+        return m_limit;
+    }
+    [[nodiscard]] BudgetPolicy policy() const noexcept
+    {
+        return m_policy;
+    }
+
+    /**
+     * @brief Returns the payload bytes in the pipes of the pipeline.
+     */
+    [[nodiscard]] size_t bytes() const noexcept
+    {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+    /**
+     * @brief Returns the number of elements dropped for exceeding the budget.
+     */
+    [[nodiscard]] uint64_t dropped() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Whether an element of the given size may enter the pipeline.
+     */
+    [[nodiscard]] bool admits(size_t bytes) const noexcept
+    {
+        size_t current = this->bytes();
+        return m_limit == 0 || current == 0 || current + bytes <= m_limit;
+    }
+
+    void add(size_t bytes) noexcept
+    {
+        m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void remove(size_t bytes) noexcept
+    {
+        m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    void countDrop() noexcept
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    const size_t m_limit;
+    const BudgetPolicy m_policy;
+
+    std::atomic<size_t> m_bytes{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+} // namespace blpl
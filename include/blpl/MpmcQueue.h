@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "Uninitialized.h"
+
+namespace blpl {
+
+/**
+ * @brief Bounded lock-free queue for any number of producers and consumers,
+ * after Dmitry Vyukov's design.
+ *
+ * Each cell carries a sequence number that tells producers and consumers
+ * whether it is free or holds an element of the current round, so a push or pop
+ * costs one compare-and-swap on the shared position in the uncontended case.
+ * The capacity is rounded up to a power of two.
+ *
+ * If constructing or moving an element throws, the exception propagates and the
+ * element is lost, while the queue stays usable.
+ */
+template <class T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity)
+        : m_mask(roundUpToPowerOfTwo(capacity) - 1)
+        , m_cells(new Cell[m_mask + 1])
+    {
+        for (size_t i = 0; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    ~MpmcQueue()
+    {
+        clear();
+    }
+
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        return m_mask + 1;
+    }
+
+    /**
+     * @brief Returns the number of elements in the queue. Only a snapshot
+     * while other threads push or pop.
+     */
+    [[nodiscard]] size_t size() const noexcept
+    {
+        size_t tail = m_dequeuePos.load(std::memory_order_acquire);
+        size_t head = m_enqueuePos.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Moves data into the queue, unless it is full.
+     *
+     * @return False if the queue is full, data is left untouched then.
+     */
+    bool tryPush(T&& data) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        return tryEmplace(std::move(data));
+    }
+
+    /**
+     * @brief Constructs an element from args in the queue, unless it is full.
+     * The arguments are only used if there is room.
+     */
+    template <class... Args>
+    bool tryEmplace(Args&&... args) noexcept(
+        std::is_nothrow_constructible<T, Args&&...>::value)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell    = m_cells[pos & m_mask];
+            size_t seq    = cell.sequence.load(std::memory_order_acquire);
+            auto distance = static_cast<std::ptrdiff_t>(seq - pos);
+            if (distance == 0) {
+                if (m_enqueuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    if constexpr (std::is_nothrow_constructible<
+                                      T, Args&&...>::value) {
+                        cell.elem.construct(std::forward<Args>(args)...);
+                    } else {
+                        try {
+                            cell.elem.construct(std::forward<Args>(args)...);
+                        } catch (...) {
+                            // hand the cell on without an element
+                            cell.hole = true;
+                            cell.sequence.store(pos + 1,
+                                                std::memory_order_release);
+                            throw;
+                        }
+                    }
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (distance < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Takes the oldest element out of the queue, if there is one.
+     */
+    std::optional<T> tryPop() noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        std::optional<T> out;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell    = m_cells[pos & m_mask];
+            size_t seq    = cell.sequence.load(std::memory_order_acquire);
+            auto distance = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (distance == 0) {
+                if (m_dequeuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    if constexpr (std::is_nothrow_move_constructible<
+                                      T>::value) {
+                        out.emplace(cell.elem.take());
+                    } else if (!take(cell, pos, out)) {
+                        pos = m_dequeuePos.load(std::memory_order_relaxed);
+                        continue;
+                    }
+                    cell.sequence.store(pos + m_mask + 1,
+                                        std::memory_order_release);
+                    return out;
+                }
+            } else if (distance < 0) {
+                return out;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Destroys all elements in the queue.
+     */
+    void clear() noexcept
+    {
+        while (true) {
+            try {
+                if (!tryPop())
+                    return;
+            } catch (...) {
+                // the element is gone anyway
+            }
+        }
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t n) noexcept
+    {
+        size_t power = 2;
+        while (power < n)
+            power *= 2;
+        return power;
+    }
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Uninitialized<T> elem;
+        /// set if constructing the element threw, only for throwing moves
+        bool hole = false;
+    };
+
+    /**
+     * @brief Moves the element of a claimed cell into out. Releases the cell
+     * and returns false if it has no element, releases it as well before
+     * passing on an exception of the move.
+     */
+    bool take(Cell& cell, size_t pos, std::optional<T>& out)
+    {
+        if (cell.hole) {
+            cell.hole = false;
+            cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            return false;
+        }
+
+        try {
+            out.emplace(std::move(cell.elem.get()));
+        } catch (...) {
+            cell.elem.destroy();
+            cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            throw;
+        }
+        cell.elem.destroy();
+        return true;
+    }
+
+private:
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // producers and consumers don't share a cache line
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+};
+
+} // namespace blpl
@@ -1,19 +1,57 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "Filter.h"
+#include "FilterMetrics.h"
 #include "Generator.h"
+#include "Tracer.h"
+#include "Uninitialized.h"
 
 namespace blpl {
 
+/**
+ * @brief How a MultiFilter distributes its input to its sub-filters.
+ */
+enum class MultiFilterScheduling
+{
+    /// sub-filter i processes element i, elements beyond the number of
+    /// sub-filters are ignored
+    Lockstep,
+    /// all elements are processed, each idle sub-filter takes the next chunk
+    /// of a fixed size
+    Dynamic,
+    /// like Dynamic, but the chunks start big and shrink as the remaining work
+    /// gets less
+    Guided
+};
+
 /**
  * @brief This is a specific filter that takes a number of filters and executes
  * them in lockstep on the input data which has to be supplied in a vector of at
  * least the number of filters.
  *
+ * A shorter input isn't processed. The result is then a vector of default
+ * constructed OutData, one per sub-filter, or an empty vector if OutData
+ * isn't default constructible.
+ *
+ * With dynamic or guided scheduling (see setScheduling()) the input vector may
+ * have any size and its elements are distributed to the sub-filters as they
+ * become idle, which balances uneven workloads. The sub-filters then have to
+ * be interchangeable. Sources with Generator input always run in lockstep.
+ *
+ * If a sub-filter throws, the other ones still finish their work, then the
+ * results are dropped and the first exception is passed on.
+ *
  * @note A multifilter should be constructed by stringing together filters with
  * the &-operator.
  */
@@ -29,6 +67,8 @@ public:
     explicit MultiFilter(
         std::vector<std::shared_ptr<FilterClass>> filterVector);
 
+    MultiFilter(const MultiFilter& other);
+
     template <class ExtendingFilter>
     MultiFilter<InData, OutData>&
     operator&(std::shared_ptr<ExtendingFilter> filter);
@@ -42,6 +82,12 @@ public:
         return m_filters.size();
     }
 
+    [[nodiscard]] const std::vector<FilterPtr<InData, OutData>>&
+    filters() const noexcept
+    {
+        return m_filters;
+    }
+
     void reset() noexcept override
     {
         for (auto& filter : m_filters)
@@ -57,11 +103,72 @@ public:
         return typeid(OutData);
     }
 
+    /**
+     * @brief Sets how the input is distributed to the sub-filters, see
+     * MultiFilterScheduling.
+     *
+     * @param chunkSize Number of elements handed out at once in dynamic mode,
+     * minimum number of elements in guided mode.
+     */
+    void setScheduling(MultiFilterScheduling scheduling, size_t chunkSize = 1)
+    {
+        m_scheduling = scheduling;
+        m_chunkSize  = chunkSize > 0 ? chunkSize : 1;
+    }
+    [[nodiscard]] MultiFilterScheduling scheduling() const noexcept
+    {
+        return m_scheduling;
+    }
+
+    /**
+     * @brief Returns the metrics of each sub-filter since construction or the
+     * last call to resetLaneMetrics(). The counter is the number of processed
+     * elements, the blocked time is the time the sub-filter was idle while
+     * waiting for the others to finish.
+     */
+    [[nodiscard]] std::vector<FilterMetrics> laneMetrics() const
+    {
+        std::vector<FilterMetrics> metrics;
+        metrics.reserve(m_filters.size());
+        for (size_t i = 0; i < m_filters.size(); ++i)
+            metrics.push_back(m_laneMetrics[i].load());
+
+        return metrics;
+    }
+    void resetLaneMetrics() noexcept
+    {
+        for (size_t i = 0; i < m_filters.size(); ++i)
+            m_laneMetrics[i].reset();
+    }
+
 protected:
     std::vector<OutData> processImpl(std::vector<InData>&& in) override;
 
+private:
+    std::vector<OutData> processDynamic(std::vector<InData>&& in);
+
+    template <class LaneFunc>
+    std::exception_ptr runLanes(LaneFunc&& lane);
+    void destroyResults(const std::vector<char>& constructed) noexcept;
+
+    void allocateResults();
+    void reserveResults(size_t size);
+    void registerTraceTracks();
+
 private:
     std::vector<FilterPtr<InData, OutData>> m_filters;
+
+    /// storage for the results of the sub-filters, so OutData does not need to
+    /// be default constructible
+    std::unique_ptr<Uninitialized<OutData>[]> m_results;
+    size_t m_resultCapacity = 0;
+
+    MultiFilterScheduling m_scheduling = MultiFilterScheduling::Lockstep;
+    size_t m_chunkSize                 = 1;
+    std::unique_ptr<detail::MetricsCounters[]> m_laneMetrics;
+
+    /// tracks the sub-filters running in their own thread are traced on
+    std::vector<uint32_t> m_traceTracks;
 };
 
 template <class InData, class OutData>
@@ -78,6 +185,7 @@ MultiFilter<InData, OutData>::MultiFilter(std::shared_ptr<Filter1> first,
 
     m_filters.push_back(first);
     m_filters.push_back(second);
+    allocateResults();
 }
 
 template <class InData, class OutData>
@@ -93,6 +201,17 @@ MultiFilter<InData, OutData>::MultiFilter(
     for (auto& filter : filterVector) {
         m_filters.push_back(filter);
     }
+    allocateResults();
+}
+
+template <class InData, class OutData>
+MultiFilter<InData, OutData>::MultiFilter(const MultiFilter& other)
+    : Filter<std::vector<InData>, std::vector<OutData>>(other)
+    , m_filters(other.m_filters)
+    , m_scheduling(other.m_scheduling)
+    , m_chunkSize(other.m_chunkSize)
+{
+    allocateResults();
 }
 
 template <class InData, class OutData>
@@ -105,6 +224,7 @@ MultiFilter<InData, OutData>::operator&(std::shared_ptr<ExtendingFilter> filter)
         "Extending filter does not inherit from the correct Filter template");
 
     m_filters.push_back(filter);
+    allocateResults();
 
     return *this;
 }
@@ -117,44 +237,208 @@ operator&(std::shared_ptr<Filter1> first, std::shared_ptr<Filter2> second)
         first, second);
 }
 
+template <class InData, class OutData>
+void MultiFilter<InData, OutData>::allocateResults()
+{
+    m_resultCapacity = 0;
+    reserveResults(m_filters.size());
+    m_laneMetrics.reset(new detail::MetricsCounters[m_filters.size()]);
+}
+
+template <class InData, class OutData>
+void MultiFilter<InData, OutData>::reserveResults(size_t size)
+{
+    if (size <= m_resultCapacity)
+        return;
+
+    m_results.reset(new Uninitialized<OutData>[size]);
+    m_resultCapacity = size;
+}
+
+template <class InData, class OutData>
+void MultiFilter<InData, OutData>::registerTraceTracks()
+{
+    if (m_traceTracks.size() == m_filters.size())
+        return;
+
+    std::string name = Tracer::demangle(typeid(*this).name());
+    m_traceTracks.resize(m_filters.size());
+    for (size_t i = 0; i < m_filters.size(); ++i)
+        m_traceTracks[i] =
+            Tracer::registerTrack(name + " lane " + std::to_string(i));
+}
+
 template <class InData, class OutData>
 std::vector<OutData>
 MultiFilter<InData, OutData>::processImpl(std::vector<InData>&& in)
 {
     assert(!m_filters.empty());
-    std::vector<OutData> out(m_filters.size());
+    const size_t numFilters = m_filters.size();
 
-    std::vector<std::thread> threads;
+    if constexpr (!std::is_same<InData, Generator>()) {
+        if (m_scheduling != MultiFilterScheduling::Lockstep)
+            return processDynamic(std::move(in));
 
-    if constexpr (std::is_same<InData, Generator>()) {
-        // call process of all sub-filters in their own thread
-        for (size_t i = 1; i < m_filters.size(); ++i)
-            threads.emplace_back(
-                [&out = out[i], &filter = m_filters[i]]() mutable {
-                    out = filter->process(std::move(Generator()));
-                });
-
-        // but execute the first filter in this thread
-        out[0] = m_filters[0]->process(std::move(Generator()));
-    } else {
-        if (in.size() >= m_filters.size()) {
-            // call process of all sub-filters in their own thread
-            for (size_t i = 1; i < m_filters.size(); ++i)
-                threads.emplace_back([&out    = out[i],
-                                      &filter = m_filters[i],
-                                      in      = std::move(in[i])]() mutable {
-                    out = filter->process(std::move(in));
-                });
-
-            // but execute the first filter in this thread
-            out[0] = m_filters[0]->process(std::move(in[0]));
+        if (in.size() < numFilters) {
+            if constexpr (std::is_default_constructible<OutData>::value)
+                return std::vector<OutData>(numFilters);
+            else
+                return std::vector<OutData>();
         }
     }
 
+    std::vector<char> constructed(numFilters, false);
+    auto error = runLanes([&](size_t i) -> uint32_t {
+        if constexpr (std::is_same<InData, Generator>())
+            m_results[i].construct(m_filters[i]->process(Generator()));
+        else
+            m_results[i].construct(m_filters[i]->process(std::move(in[i])));
+        constructed[i] = true;
+        return 1;
+    });
+    if (error) {
+        destroyResults(constructed);
+        std::rethrow_exception(error);
+    }
+
+    std::vector<OutData> out;
+    out.reserve(numFilters);
+    for (size_t i = 0; i < numFilters; ++i)
+        out.push_back(m_results[i].take());
+
+    return out;
+}
+
+/**
+ * @brief Processes all elements of the input, handing them out to the
+ * sub-filters in chunks as they become idle.
+ */
+template <class InData, class OutData>
+std::vector<OutData>
+MultiFilter<InData, OutData>::processDynamic(std::vector<InData>&& in)
+{
+    const size_t numItems   = in.size();
+    const size_t numFilters = m_filters.size();
+    reserveResults(numItems);
+
+    std::atomic<size_t> next{0};
+    auto chunkSize = [this, numItems, numFilters](size_t first) -> size_t {
+        if (m_scheduling == MultiFilterScheduling::Dynamic || first >= numItems)
+            return m_chunkSize;
+        // guided: split half of the remaining work evenly
+        return std::max(m_chunkSize, (numItems - first) / (2 * numFilters));
+    };
+
+    std::vector<char> constructed(numItems, false);
+    auto error = runLanes([&](size_t i) -> uint32_t {
+        uint32_t count = 0;
+        while (true) {
+            size_t chunk = chunkSize(next.load(std::memory_order_relaxed));
+            size_t first = next.fetch_add(chunk, std::memory_order_relaxed);
+            if (first >= numItems)
+                break;
+
+            size_t last = std::min(first + chunk, numItems);
+            for (size_t j = first; j < last; ++j) {
+                m_results[j].construct(
+                    m_filters[i]->process(std::move(in[j])));
+                constructed[j] = true;
+            }
+            count += static_cast<uint32_t>(last - first);
+        }
+        return count;
+    });
+    if (error) {
+        destroyResults(constructed);
+        std::rethrow_exception(error);
+    }
+
+    std::vector<OutData> out;
+    out.reserve(numItems);
+    for (size_t i = 0; i < numItems; ++i)
+        out.push_back(m_results[i].take());
+
+    return out;
+}
+
+/**
+ * @brief Calls lane(i) for every sub-filter i in parallel and records how long
+ * each lane was busy and how long it waited for the others to finish. lane
+ * returns the number of elements it processed.
+ *
+ * @return The exception of the first lane that threw one, after all lanes are
+ * done.
+ */
+template <class InData, class OutData>
+template <class LaneFunc>
+std::exception_ptr MultiFilter<InData, OutData>::runLanes(LaneFunc&& lane)
+{
+    using Clock             = detail::MetricsCounters::Clock;
+    const size_t numFilters = m_filters.size();
+
+    const bool tracing = Tracer::isEnabled();
+    if (tracing)
+        registerTraceTracks();
+
+    struct LaneTiming
+    {
+        Clock::time_point begin;
+        Clock::time_point end;
+        uint32_t count = 0;
+    };
+    std::vector<LaneTiming> timings(numFilters);
+    // an exception must not escape a lane thread
+    std::vector<std::exception_ptr> errors(numFilters);
+    auto runLane = [&lane, &timings, &errors](size_t i) {
+        timings[i].begin = Clock::now();
+        try {
+            timings[i].count = lane(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+        timings[i].end = Clock::now();
+    };
+
+    // run all sub-filters but the first in their own thread
+    std::vector<std::thread> threads;
+    threads.reserve(numFilters - 1);
+    for (size_t i = 1; i < numFilters; ++i)
+        threads.emplace_back(
+            [&runLane, i, track = tracing ? m_traceTracks[i] : 0] {
+                Tracer::setTrack(track);
+                runLane(i);
+            });
+
+    // but execute the first filter in this thread
+    runLane(0);
+
     for (auto& thread : threads)
         thread.join();
 
-    return out;
+    auto joined = Clock::now();
+    for (size_t i = 0; i < numFilters; ++i)
+        m_laneMetrics[i].add(timings[i].end - timings[i].begin,
+                             joined - timings[i].end,
+                             timings[i].count);
+
+    for (auto& error : errors) {
+        if (error)
+            return error;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Destroys the results the lanes constructed before one of them threw.
+ */
+template <class InData, class OutData>
+void MultiFilter<InData, OutData>::destroyResults(
+    const std::vector<char>& constructed) noexcept
+{
+    for (size_t i = 0; i < constructed.size(); ++i) {
+        if (constructed[i])
+            m_results[i].destroy();
+    }
 }
 
 } // namespace blpl
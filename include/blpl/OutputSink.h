@@ -0,0 +1,117 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace blpl {
+
+namespace detail {
+
+/**
+ * @brief Receives the results of a pipeline on the thread of its last filter
+ * and hands them to waiting futures, a callback or a batch callback, in that
+ * order of precedence.
+ *
+ * Installed as the sink of the out pipe by Pipeline, results nobody asked for
+ * are stored in the out pipe as usual.
+ */
+template <class TData>
+class OutputSink
+{
+public:
+    using Callback      = std::function<void(TData&&)>;
+    using BatchCallback = std::function<void(std::vector<TData>&&)>;
+
+    void setCallback(Callback callback)
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_callback      = std::move(callback);
+        m_batchCallback = nullptr;
+    }
+
+    void setBatchCallback(size_t batchSize, BatchCallback callback)
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_batchCallback = std::move(callback);
+        m_batchSize     = batchSize > 0 ? batchSize : 1;
+        m_callback      = nullptr;
+        m_batch.reserve(m_batchSize);
+    }
+
+    std::future<TData> next()
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_promises.emplace_back();
+        return m_promises.back().get_future();
+    }
+
+    /**
+     * @brief Offers a result to the sink. Returns false if nobody takes it.
+     */
+    bool deliver(TData& data)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_promises.empty()) {
+            auto promise = std::move(m_promises.front());
+            m_promises.pop_front();
+            lock.unlock();
+
+            promise.set_value(std::move(data));
+            return true;
+        }
+
+        if (m_batchCallback) {
+            m_batch.push_back(std::move(data));
+            if (m_batch.size() >= m_batchSize)
+                deliverBatch(lock);
+            return true;
+        }
+
+        if (m_callback) {
+            // the callbacks are only replaced while the pipeline is stopped
+            lock.unlock();
+
+            m_callback(std::move(data));
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Hands on the incomplete batch, if any.
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_batch.empty() && m_batchCallback)
+            deliverBatch(lock);
+    }
+
+private:
+    void deliverBatch(std::unique_lock<std::mutex>& lock)
+    {
+        std::vector<TData> batch;
+        batch.swap(m_batch);
+        m_batch.reserve(m_batchSize);
+        lock.unlock();
+
+        m_batchCallback(std::move(batch));
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<std::promise<TData>> m_promises;
+    Callback m_callback;
+    BatchCallback m_batchCallback;
+    size_t m_batchSize = 1;
+    std::vector<TData> m_batch;
+};
+
+} // namespace detail
+
+} // namespace blpl
@@ -1,69 +1,714 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "AbstractPipe.h"
 #include "Generator.h"
+#include "MpmcQueue.h"
+#include "PriorityQueue.h"
+#include "TraceScope.h"
+#include "Uninitialized.h"
 
 namespace blpl {
 
 /**
  * Implements the pipes in the pipeline.
+ *
+ * The element is kept in raw storage, so TData only has to be
+ * move-constructible. Use tryPop() or blockingTryPop() for payloads that are
+ * not default-constructible, pop() and blockingPop() require the pipe to hold
+ * an element for those.
+ *
+ * By default a pipe holds a single element and expects one thread to push and
+ * one to pop. With a capacity, it becomes a bounded lock-free queue that any
+ * number of threads may push into and pop from at the same time. A waiting
+ * pipe then blocks pushes while the queue is full, a discarding one drops its
+ * oldest element.
+ *
+ * With priority levels, the pipe keeps a queue per level instead, see
+ * PriorityQueue. Pops take the most urgent element, a full discarding pipe
+ * drops the oldest element of the level it pushes into.
+ *
+ * Pushing and popping only throw if moving TData does. The element is lost
+ * then, while the pipe stays usable.
+ *
  * @tparam TData Type of the data to pass through the Pipe.
  */
 template <typename TData>
 class Pipe : public AbstractPipe
 {
 public:
-    explicit Pipe(bool waitForSlowestFilter = false);
-    virtual ~Pipe() = default;
+    explicit Pipe(bool waitForSlowestFilter = false, size_t capacity = 0);
+    virtual ~Pipe();
+
+    TData pop() noexcept(nothrowPop);
+    TData blockingPop() noexcept(nothrowPop);
+
+    std::optional<TData> tryPop() noexcept(nothrowMove);
+    std::optional<TData> blockingTryPop() noexcept(nothrowMove);
+
+    void push(TData&& data) noexcept(nothrowMove);
+
+    bool tryPush(TData&& data) noexcept(nothrowMove);
+    template <class Rep, class Period>
+    bool tryPushFor(TData&& data,
+                    const std::chrono::duration<Rep, Period>& timeout) noexcept(
+        nothrowMove);
+    size_t tryPushBatch(std::vector<TData>& batch) noexcept(nothrowMove);
+
+    /**
+     * @brief Returns the number of elements the try-push methods turned away.
+     */
+    [[nodiscard]] uint64_t rejectedPushes() const noexcept
+    {
+        return m_rejected.load(std::memory_order_relaxed);
+    }
+
+    void reset() noexcept override;
+
+    /**
+     * @brief Registers a sink that is offered each element pushed into the
+     * pipe before it is stored. Elements the sink takes, i.e. for which it
+     * returns true, never enter the pipe. Set it while the pipe is not in use.
+     */
+    void setSink(std::function<bool(TData&)> sink) noexcept
+    {
+        m_sink = std::move(sink);
+    }
+
+    bool setCapacity(size_t capacity) noexcept override;
+    [[nodiscard]] size_t capacity() const noexcept;
+    bool setPriorityLevels(size_t levels,
+                           size_t capacity,
+                           uint32_t starvationLimit) noexcept override;
+    std::vector<PriorityMetrics> priorityMetrics() const override;
+    bool setMemoryBudget(std::shared_ptr<MemoryBudget> budget,
+                         bool admission) noexcept override;
+    unsigned int size() const noexcept override;
+
+private:
+    void pushQueued(TData&& data, size_t bytes) noexcept(nothrowMove);
+    bool insert(TData& data) noexcept(nothrowMove);
+    bool admit(size_t bytes) noexcept;
+    size_t payloadBytes(const TData& data) const noexcept;
+    void addBytes(size_t bytes) noexcept;
+    void removeBytes(size_t bytes) noexcept;
+    bool isQueued() const noexcept;
+    bool queuePush(TData& data) noexcept(nothrowMove);
+    std::optional<TData> queuePop() noexcept(nothrowMove);
+    std::optional<TData> queueDrop(const TData& data) noexcept(nothrowMove);
+    size_t queueSize() const noexcept;
+    bool holdsElement() const noexcept;
+    void waitForElement() noexcept;
+    void lock() noexcept;
+    void unlock() noexcept;
+
+    static TData empty() noexcept(nothrowPop);
 
-    TData pop() noexcept;
-    TData blockingPop() noexcept;
+    static constexpr bool nothrowMove =
+        std::is_nothrow_move_constructible<TData>::value;
+    static constexpr bool nothrowPop =
+        nothrowMove && std::is_nothrow_default_constructible<TData>::value;
 
-    void push(TData&& data) noexcept;
+    /**
+     * @brief Holds the spin lock of the pipe for its lifetime, so a throwing
+     * move doesn't leave it locked.
+     */
+    class ScopedLock
+    {
+    public:
+        explicit ScopedLock(Pipe& pipe) noexcept
+            : m_pipe(pipe)
+        {
+            m_pipe.lock();
+        }
+        ScopedLock(const ScopedLock&) = delete;
+        ScopedLock& operator=(const ScopedLock&) = delete;
+        ~ScopedLock()
+        {
+            m_pipe.unlock();
+        }
+
+    private:
+        Pipe& m_pipe;
+    };
+
+    /**
+     * @brief Takes bytes accounted ahead of a push off the budget again,
+     * unless the push commits them.
+     */
+    class PendingBytes
+    {
+    public:
+        PendingBytes(Pipe& pipe, size_t bytes) noexcept
+            : m_pipe(pipe)
+            , m_bytes(bytes)
+        {}
+        PendingBytes(const PendingBytes&) = delete;
+        PendingBytes& operator=(const PendingBytes&) = delete;
+        ~PendingBytes()
+        {
+            if (m_bytes > 0)
+                m_pipe.removeBytes(m_bytes);
+        }
+
+        void commit() noexcept
+        {
+            m_bytes = 0;
+        }
+
+    private:
+        Pipe& m_pipe;
+        size_t m_bytes;
+    };
 
 private:
-    TData m_elem;
+    Uninitialized<TData> m_elem;
+    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+
+    /// replaces the single element if the pipe has a capacity
+    std::unique_ptr<MpmcQueue<TData>> m_queue;
+    /// replaces it if the pipe has priority levels
+    std::unique_ptr<PriorityQueue<TData>> m_priorityQueue;
+
+    std::atomic<uint64_t> m_rejected{0};
+
+    std::function<bool(TData&)> m_sink;
 };
 
 template <typename TData>
-Pipe<TData>::Pipe(bool waitForSlowestFilter)
+Pipe<TData>::Pipe(bool waitForSlowestFilter, size_t capacity)
     : AbstractPipe(waitForSlowestFilter)
-{}
+{
+    setCapacity(capacity);
+}
 
 template <typename TData>
-TData Pipe<TData>::pop() noexcept
+Pipe<TData>::~Pipe()
 {
-    TData temp = std::move(m_elem);
-    m_valid    = false;
-    return temp;
+    reset();
 }
 
+/**
+ * @brief Takes the element out of the pipe.
+ *
+ * @note If the pipe is empty, a default constructed TData is returned. For
+ * types that are not default constructible, the pipe must not be empty.
+ */
 template <typename TData>
-TData Pipe<TData>::blockingPop() noexcept
+TData Pipe<TData>::pop() noexcept(nothrowPop)
 {
-    while (!m_valid && m_enabled)
-        std::this_thread::yield();
+    if (isQueued()) {
+        if (auto out = tryPop())
+            return std::move(*out);
+        return empty();
+    }
+
+    std::optional<TData> out;
+    {
+        ScopedLock lock(*this);
+        if (m_valid) {
+            out.emplace(m_elem.take());
+            m_valid = false;
+        }
+    }
+    if (out) {
+        removeBytes(payloadBytes(*out));
+        return std::move(*out);
+    }
+
+    return empty();
+}
+
+/**
+ * @brief Waits for an element and takes it out of the pipe. Returns
+ * immediately if the pipe gets disabled, see pop() for that case.
+ */
+template <typename TData>
+TData Pipe<TData>::blockingPop() noexcept(nothrowPop)
+{
+    waitForElement();
 
     return pop();
 }
 
+/**
+ * @brief Takes the element out of the pipe if it holds one.
+ */
 template <typename TData>
-void Pipe<TData>::push(TData&& data) noexcept
+std::optional<TData> Pipe<TData>::tryPop() noexcept(nothrowMove)
 {
-    while (m_waitForSlowestFilter && m_valid && m_enabled)
+    std::optional<TData> out;
+    if (isQueued()) {
+        out = queuePop();
+    } else if (m_valid) {
+        ScopedLock lock(*this);
+        if (m_valid) {
+            out.emplace(std::move(m_elem.get()));
+            m_elem.destroy();
+            m_valid = false;
+        }
+    }
+
+    if (out)
+        removeBytes(payloadBytes(*out));
+    return out;
+}
+
+/**
+ * @brief Waits for an element and takes it out of the pipe. Returns an empty
+ * optional if the pipe gets disabled before an element arrives.
+ */
+template <typename TData>
+std::optional<TData>
+Pipe<TData>::blockingTryPop() noexcept(nothrowMove)
+{
+    waitForElement();
+
+    return tryPop();
+}
+
+template <typename TData>
+void Pipe<TData>::push(TData&& data) noexcept(nothrowMove)
+{
+    if (m_sink && m_enabled && m_sink(data)) {
+        fulfillRequest();
+        return;
+    }
+
+    size_t bytes = payloadBytes(data);
+    if (!admit(bytes))
+        return;
+
+    if (isQueued()) {
+        pushQueued(std::move(data), bytes);
+        return;
+    }
+
+    if (m_waitForSlowestFilter && m_valid && m_enabled) {
+        TraceScope trace("pipe", "push wait");
+        while (m_waitForSlowestFilter && m_valid && m_enabled)
+            std::this_thread::yield();
+    }
+    // don't overtake a reset marker
+    while (hasResetMarker() && m_enabled)
         std::this_thread::yield();
 
     if (!m_enabled)
         return;
 
+    {
+        ScopedLock lock(*this);
+        if (m_valid) {
+            removeBytes(payloadBytes(m_elem.get()));
+            m_elem.destroy();
+            m_valid = false;
+        }
+        m_elem.construct(std::move(data));
+        m_valid = true;
+        addBytes(bytes);
+    }
+
+    fulfillRequest();
+    m_pushCallback();
+}
+
+/**
+ * @brief Pushes data into the pipe if there is room for it, without waiting or
+ * dropping another element, even if the pipe is a discarding one.
+ *
+ * @return False if the pipe is full or disabled, data is left untouched then.
+ */
+template <typename TData>
+bool Pipe<TData>::tryPush(TData&& data) noexcept(nothrowMove)
+{
+    if (!insert(data)) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_pushCallback();
+    return true;
+}
+
+/**
+ * @brief Like tryPush(), but waits up to timeout for room in the pipe. Backs
+ * off from yielding to sleeping, so a long wait doesn't occupy a core.
+ */
+template <typename TData>
+template <class Rep, class Period>
+bool Pipe<TData>::tryPushFor(
+    TData&& data,
+    const std::chrono::duration<Rep, Period>& timeout) noexcept(nothrowMove)
+{
+    using Clock   = std::chrono::steady_clock;
+    auto deadline = Clock::now() + timeout;
+    auto backoff  = std::chrono::microseconds(1);
+
+    if (!insert(data)) {
+        TraceScope trace("pipe", "push wait");
+        for (int attempt = 0; !insert(data); ++attempt) {
+            auto now = Clock::now();
+            if (now >= deadline || !m_enabled) {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (attempt < 16) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(
+                    std::min<Clock::duration>(backoff, deadline - now));
+                backoff =
+                    std::min(backoff * 2, std::chrono::microseconds(1000));
+            }
+        }
+    }
+
+    m_pushCallback();
+    return true;
+}
+
+/**
+ * @brief Pushes the elements of batch from the front until the pipe is full.
+ * The pushed elements are removed from the batch, the others stay in it and
+ * count as rejected.
+ *
+ * @return The number of pushed elements.
+ */
+template <typename TData>
+size_t
+Pipe<TData>::tryPushBatch(std::vector<TData>& batch) noexcept(nothrowMove)
+{
+    size_t pushed = 0;
+    while (pushed < batch.size() && insert(batch[pushed]))
+        ++pushed;
+
+    batch.erase(batch.begin(), batch.begin() + pushed);
+    m_rejected.fetch_add(batch.size(), std::memory_order_relaxed);
+
+    if (pushed > 0)
+        m_pushCallback();
+    return pushed;
+}
+
+/**
+ * @brief Destroys the element and drops the reset marker in the pipe, if any.
+ */
+template <typename TData>
+void Pipe<TData>::reset() noexcept
+{
+    ScopedLock lock(*this);
+    if (m_valid) {
+        removeBytes(payloadBytes(m_elem.get()));
+        m_elem.destroy();
+    }
     m_valid = false;
-    m_elem  = std::move(data);
-    m_valid = true;
+    while (isQueued()) {
+        try {
+            auto elem = queuePop();
+            if (!elem)
+                break;
+            removeBytes(payloadBytes(*elem));
+        } catch (...) {
+            // the element is gone anyway
+        }
+    }
+    m_resetMarker.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Turns the pipe into a queue of at least capacity elements, or back
+ * into a single slot for a capacity of 0. Drops the elements in the pipe.
+ */
+template <typename TData>
+bool Pipe<TData>::setCapacity(size_t capacity) noexcept
+{
+    reset();
+    m_priorityQueue.reset();
+    if (capacity > 0)
+        m_queue = std::make_unique<MpmcQueue<TData>>(capacity);
+    else
+        m_queue.reset();
+
+    return true;
+}
+
+template <typename TData>
+size_t Pipe<TData>::capacity() const noexcept
+{
+    if (m_priorityQueue)
+        return m_priorityQueue->capacity();
+    return m_queue ? m_queue->capacity() : 1;
+}
+
+/**
+ * @brief Gives the pipe a queue of at least capacity elements per priority
+ * level, or makes it a single slot again for less than two levels. Drops the
+ * elements in the pipe.
+ */
+template <typename TData>
+bool Pipe<TData>::setPriorityLevels(size_t levels,
+                                    size_t capacity,
+                                    uint32_t starvationLimit) noexcept
+{
+    reset();
+    m_queue.reset();
+    if (levels > 1)
+        m_priorityQueue = std::make_unique<PriorityQueue<TData>>(
+            levels, std::max<size_t>(capacity, 1), starvationLimit);
+    else
+        m_priorityQueue.reset();
+
+    return true;
+}
+
+/**
+ * @brief Returns the latencies per priority level, the least urgent one first.
+ */
+template <typename TData>
+std::vector<PriorityMetrics> Pipe<TData>::priorityMetrics() const
+{
+    if (!m_priorityQueue)
+        return {};
+    return m_priorityQueue->metrics();
+}
+
+/**
+ * @brief Accounts the payload bytes to budget from now on. Drops the elements
+ * in the pipe, so they don't have to be accounted.
+ */
+template <typename TData>
+bool Pipe<TData>::setMemoryBudget(std::shared_ptr<MemoryBudget> budget,
+                                  bool admission) noexcept
+{
+    reset();
+    m_budget    = std::move(budget);
+    m_admission = m_budget && admission;
+    m_bytes     = 0;
+
+    return true;
+}
+
+template <typename TData>
+unsigned int Pipe<TData>::size() const noexcept
+{
+    size_t elements = isQueued() ? queueSize() : (m_valid ? 1 : 0);
+    return static_cast<unsigned int>(elements) + (hasResetMarker() ? 1 : 0);
+}
+
+template <typename TData>
+void Pipe<TData>::pushQueued(TData&& data,
+                             size_t bytes) noexcept(nothrowMove)
+{
+    // don't overtake a reset marker
+    while (hasResetMarker() && m_enabled)
+        std::this_thread::yield();
+
+    if (!m_enabled)
+        return;
+
+    // account first, so a consumer never removes bytes that weren't added
+    addBytes(bytes);
+    PendingBytes pending(*this, bytes);
+    if (!m_waitForSlowestFilter) {
+        // a full discarding pipe drops its oldest element
+        while (!queuePush(data)) {
+            if (auto dropped = queueDrop(data))
+                removeBytes(payloadBytes(*dropped));
+        }
+    } else if (!queuePush(data)) {
+        TraceScope trace("pipe", "push wait");
+        do {
+            if (!m_enabled)
+                return;
+            std::this_thread::yield();
+        } while (!queuePush(data));
+    }
+    pending.commit();
+
+    fulfillRequest();
     m_pushCallback();
 }
 
+/**
+ * @brief Moves data into the pipe if it has room and is enabled, without
+ * calling the push callback.
+ */
+template <typename TData>
+bool Pipe<TData>::insert(TData& data) noexcept(nothrowMove)
+{
+    // don't overtake a reset marker
+    if (!m_enabled || hasResetMarker())
+        return false;
+
+    size_t bytes = payloadBytes(data);
+    if (m_admission && !m_budget->admits(bytes))
+        return false;
+
+    addBytes(bytes);
+    PendingBytes pending(*this, bytes);
+    bool inserted = false;
+    if (isQueued()) {
+        inserted = queuePush(data);
+    } else {
+        ScopedLock lock(*this);
+        if (!m_valid) {
+            m_elem.construct(std::move(data));
+            m_valid  = true;
+            inserted = true;
+        }
+    }
+
+    if (inserted) {
+        pending.commit();
+        fulfillRequest();
+    }
+    return inserted;
+}
+
+/**
+ * @brief Waits until the budget admits an element of the given size, or drops
+ * it, depending on the policy. Returns false if the element may not enter.
+ */
+template <typename TData>
+bool Pipe<TData>::admit(size_t bytes) noexcept
+{
+    if (!m_admission || m_budget->admits(bytes))
+        return true;
+
+    if (m_budget->policy() == BudgetPolicy::Drop) {
+        m_budget->countDrop();
+        return false;
+    }
+
+    TraceScope trace("pipe", "budget wait");
+    while (!m_budget->admits(bytes) && m_enabled)
+        std::this_thread::yield();
+    return m_enabled;
+}
+
+template <typename TData>
+size_t Pipe<TData>::payloadBytes(const TData& data) const noexcept
+{
+    return m_budget ? PayloadSize<TData>::of(data) : 0;
+}
+
+template <typename TData>
+void Pipe<TData>::addBytes(size_t bytes) noexcept
+{
+    if (!m_budget)
+        return;
+
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    m_budget->add(bytes);
+}
+
+template <typename TData>
+void Pipe<TData>::removeBytes(size_t bytes) noexcept
+{
+    if (!m_budget)
+        return;
+
+    m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    m_budget->remove(bytes);
+}
+
+template <typename TData>
+bool Pipe<TData>::isQueued() const noexcept
+{
+    return m_queue || m_priorityQueue;
+}
+
+/**
+ * @brief Moves data into the queue or its priority level, unless that is full.
+ * Data is left untouched then.
+ */
+template <typename TData>
+bool Pipe<TData>::queuePush(TData& data) noexcept(nothrowMove)
+{
+    if (m_priorityQueue)
+        return m_priorityQueue->tryPush(std::move(data));
+    return m_queue->tryPush(std::move(data));
+}
+
+template <typename TData>
+std::optional<TData> Pipe<TData>::queuePop() noexcept(nothrowMove)
+{
+    if (m_priorityQueue)
+        return m_priorityQueue->tryPop();
+    return m_queue->tryPop();
+}
+
+/**
+ * @brief Takes out the element to drop to make room for data.
+ */
+template <typename TData>
+std::optional<TData>
+Pipe<TData>::queueDrop(const TData& data) noexcept(nothrowMove)
+{
+    if (m_priorityQueue)
+        return m_priorityQueue->tryPopLevel(m_priorityQueue->levelOf(data));
+    return m_queue->tryPop();
+}
+
+template <typename TData>
+size_t Pipe<TData>::queueSize() const noexcept
+{
+    return m_priorityQueue ? m_priorityQueue->size() : m_queue->size();
+}
+
+template <typename TData>
+bool Pipe<TData>::holdsElement() const noexcept
+{
+    return isQueued() ? queueSize() > 0 : m_valid.load();
+}
+
+template <typename TData>
+void Pipe<TData>::waitForElement() noexcept
+{
+    if (holdsElement() || !m_enabled)
+        return;
+
+    TraceScope trace("pipe", "pop wait");
+    while (!holdsElement() && m_enabled)
+        std::this_thread::yield();
+}
+
+template <typename TData>
+void Pipe<TData>::lock() noexcept
+{
+    while (m_lock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+template <typename TData>
+void Pipe<TData>::unlock() noexcept
+{
+    m_lock.clear(std::memory_order_release);
+}
+
+template <typename TData>
+TData Pipe<TData>::empty() noexcept(nothrowPop)
+{
+    if constexpr (std::is_default_constructible<TData>::value) {
+        return TData();
+    } else {
+        // there is nothing we could return
+        std::terminate();
+    }
+}
+
 /// GENERATOR PIPES
 template <>
 class Pipe<Generator> : public AbstractPipe
@@ -82,6 +727,14 @@ public:
     {
         return pop();
     }
+    std::optional<Generator> tryPop() noexcept
+    {
+        return pop();
+    }
+    std::optional<Generator> blockingTryPop() noexcept
+    {
+        return pop();
+    }
 
     unsigned int size() const noexcept override
     {
@@ -105,6 +758,14 @@ public:
     {
         return pop();
     }
+    std::optional<std::vector<Generator>> tryPop() noexcept
+    {
+        return pop();
+    }
+    std::optional<std::vector<Generator>> blockingTryPop() noexcept
+    {
+        return pop();
+    }
 
     unsigned int size() const noexcept override
     {
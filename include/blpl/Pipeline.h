@@ -1,12 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <list>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "AbstractPipeline.h"
 #include "FilterThread.h"
+#include "OutputSink.h"
 
 namespace blpl {
 
+/**
+ * @brief Fill level of the in pipe of a pipeline and the number of elements it
+ * turned away.
+ */
+struct IngressStats
+{
+    size_t depth      = 0;
+    size_t capacity   = 0;
+    uint64_t rejected = 0;
+};
+
 /**
  * @brief Main pipeline template.
  *
@@ -71,12 +91,125 @@ public:
         return m_inPipe;
     }
 
+    /**
+     * @brief Ingress API for pipelines whose first filter takes real input
+     * instead of a Generator, safe to call from several threads.
+     *
+     * Give the in pipe a capacity with setPipeCapacity(0, capacity) first, so
+     * the pipeline queues bursts of input. None of these calls drops an element
+     * that is already in the pipe, elements that don't fit are rejected and
+     * counted instead.
+     */
+    bool tryPush(InData&& data)
+    {
+        return m_inPipe->tryPush(std::move(data));
+    }
+    /**
+     * @brief Waits up to timeout for room in the in pipe.
+     */
+    template <class Rep, class Period>
+    bool pushFor(InData&& data,
+                 const std::chrono::duration<Rep, Period>& timeout)
+    {
+        return m_inPipe->tryPushFor(std::move(data), timeout);
+    }
+    /**
+     * @brief Pushes the elements of batch until the in pipe is full and removes
+     * them from the batch. Returns the number of pushed elements.
+     */
+    size_t pushBatch(std::vector<InData>& batch)
+    {
+        return m_inPipe->tryPushBatch(batch);
+    }
+    /**
+     * @brief Requests a result from a pipeline in pull mode, see
+     * setPullMode(), and waits up to timeout for it. Returns a result that is
+     * already in the out pipe right away, the request then stays for a later
+     * call.
+     *
+     * Each call requests a result of its own, so several threads may pull at
+     * the same time. Results aren't tied to a caller though, any of them may
+     * get the one that arrives first. The request is withdrawn on timeout.
+     */
+    template <class Rep, class Period>
+    std::optional<OutData>
+    pullFor(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        using Clock   = std::chrono::steady_clock;
+        auto deadline = Clock::now() + timeout;
+        auto backoff  = std::chrono::microseconds(1);
+
+        // request before looking, a result that is already there may have been
+        // requested by another caller
+        m_outPipe->request(1);
+        for (int attempt = 0;; ++attempt) {
+            if (auto out = m_outPipe->tryPop())
+                return out;
+
+            auto now = Clock::now();
+            if (now >= deadline) {
+                m_outPipe->cancelRequest(1);
+                return std::nullopt;
+            }
+            if (attempt < 16) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(
+                    std::min<Clock::duration>(backoff, deadline - now));
+                backoff =
+                    std::min(backoff * 2, std::chrono::microseconds(1000));
+            }
+        }
+    }
+
+    [[nodiscard]] IngressStats ingressStats() const
+    {
+        IngressStats stats;
+        stats.depth    = m_inPipe->size();
+        stats.capacity = m_inPipe->capacity();
+        stats.rejected = m_inPipe->rejectedPushes();
+        return stats;
+    }
+
+    /**
+     * @brief Hands each result to callback on the thread of the last filter,
+     * instead of storing it in the out pipe. Pass nullptr to store the results
+     * again.
+     *
+     * @note Only set the callbacks while the pipeline is stopped.
+     */
+    void setOutputCallback(std::function<void(OutData&&)> callback)
+    {
+        outputSink().setCallback(std::move(callback));
+    }
+    /**
+     * @brief Hands the results to callback in batches of batchSize, and the
+     * incomplete batch whenever the last filter runs out of input or stops.
+     */
+    void
+    setOutputCallback(size_t batchSize,
+                      std::function<void(std::vector<OutData>&&)> callback)
+    {
+        outputSink().setBatchCallback(batchSize, std::move(callback));
+    }
+    /**
+     * @brief Returns a future for the next result that is not yet produced.
+     * Requested results bypass the output callbacks and the out pipe.
+     */
+    std::future<OutData> nextOutput()
+    {
+        return outputSink().next();
+    }
+
 private:
     explicit Pipeline() = default;
 
+    detail::OutputSink<OutData>& outputSink();
+
 private:
     std::shared_ptr<Pipe<InData>> m_inPipe;
     std::shared_ptr<Pipe<OutData>> m_outPipe;
+    std::shared_ptr<detail::OutputSink<OutData>> m_outputSink;
 
     template <class, class>
     friend class Pipeline;
@@ -384,21 +517,26 @@ Pipeline<InData, OutData>::Pipeline(
         std::is_same<typename ExtendingFilter::outType, OutData>::value,
         "Filters are incompatible");
 
+    // the watchdog would miss the new stage
+    pipeline.stopWatchdog();
     m_filterThreads = std::move(pipeline.m_filterThreads);
     m_filters       = std::move(pipeline.m_filters);
+    m_pipes         = std::move(pipeline.m_pipes);
 
     // prepare the pipe
     auto betweenPipe = std::move(pipeline.m_outPipe);
     betweenPipe->setWaitForSlowestFilter(waitForSlowestFilter);
+    betweenPipe->setSink(nullptr);
+    betweenPipe->registerFlushCallback(nullptr);
     m_outPipe = std::make_shared<Pipe<OutData>>(false);
 
     // add the filter thread
     m_filterThreads.push_back(
-        std::make_shared<
-            FilterThread<typename ExtendingFilter::inType, OutData>>(
+        std::make_shared<typename FilterThreadType<ExtendingFilter>::type>(
             betweenPipe, extender, m_outPipe));
 
     m_filters.push_back(extender);
+    m_pipes.push_back(m_outPipe);
 }
 
 /**
@@ -428,16 +566,33 @@ Pipeline<InData, OutData>::Pipeline(std::shared_ptr<Filter1> first,
 
     // then create the filter threads
     m_filterThreads.push_back(
-        std::make_shared<
-            FilterThread<typename Filter1::inType, typename Filter1::outType>>(
+        std::make_shared<typename FilterThreadType<Filter1>::type>(
             m_inPipe, first, betweenPipe));
     m_filterThreads.push_back(
-        std::make_shared<
-            FilterThread<typename Filter2::inType, typename Filter2::outType>>(
+        std::make_shared<typename FilterThreadType<Filter2>::type>(
             betweenPipe, second, m_outPipe));
 
     m_filters.push_back(first);
     m_filters.push_back(second);
+    m_pipes = {m_inPipe, betweenPipe, m_outPipe};
+}
+
+/**
+ * @brief Returns the sink of the out pipe, installing it on first use.
+ */
+template <class InData, class OutData>
+detail::OutputSink<OutData>& Pipeline<InData, OutData>::outputSink()
+{
+    if (!m_outputSink) {
+        m_outputSink = std::make_shared<detail::OutputSink<OutData>>();
+        m_outPipe->setSink([sink = m_outputSink](OutData& data) {
+            return sink->deliver(data);
+        });
+        m_outPipe->registerFlushCallback(
+            [sink = m_outputSink] { sink->flush(); });
+    }
+
+    return *m_outputSink;
 }
 
 } // namespace blpl
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MpmcQueue.h"
+
+namespace blpl {
+
+/**
+ * @brief Tells the priority level of a payload in pipes with priority levels,
+ * higher levels are more urgent. Levels beyond the highest one of a pipe count
+ * as the highest one.
+ *
+ * By default every payload has the lowest level 0. Specialize it for payloads
+ * that carry a priority, e.g. a flag for interactive requests. Since each stage
+ * computes the level of its results anew, the level of the results should be
+ * derived from the same field as the level of the inputs.
+ */
+template <class T, class = void>
+struct PriorityOf
+{
+    static size_t of(const T&) noexcept
+    {
+        return 0;
+    }
+};
+
+/**
+ * @brief How long the elements of one priority level waited in a pipe, from
+ * the push until they were taken out.
+ */
+struct PriorityMetrics
+{
+    /// number of elements taken out of this level
+    uint64_t counter = 0;
+    /// number of them taken out ahead of more urgent ones to prevent starvation
+    uint64_t promoted = 0;
+    std::chrono::nanoseconds meanLatency{};
+    std::chrono::nanoseconds maxLatency{};
+    /// upper bound of the 99th percentile, exact up to a factor of two
+    std::chrono::nanoseconds p99Latency{};
+};
+
+/**
+ * @brief Bounded lock-free queue with a small fixed number of priority levels,
+ * one MpmcQueue per level.
+ *
+ * tryPop() takes the oldest element of the most urgent non-empty level. To keep
+ * bulk traffic from starving, a non-empty level that was passed over
+ * starvationLimit times in a row gets the next element taken from it instead.
+ * Each element is stamped on push to measure the latency per level.
+ */
+template <class T>
+class PriorityQueue
+{
+public:
+    static constexpr size_t maxLevels = 8;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param levels Number of priority levels, at most maxLevels.
+     * @param capacity Capacity of each level.
+     * @param starvationLimit How often a waiting level may be passed over, 0
+     * for strict priorities.
+     */
+    PriorityQueue(size_t levels, size_t capacity, uint32_t starvationLimit)
+        : m_starvationLimit(starvationLimit)
+    {
+        levels = std::clamp<size_t>(levels, 1, maxLevels);
+        m_levels.reserve(levels);
+        for (size_t i = 0; i < levels; ++i)
+            m_levels.push_back(std::make_unique<Level>(capacity));
+    }
+
+    [[nodiscard]] size_t levels() const noexcept
+    {
+        return m_levels.size();
+    }
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        return m_levels.size() * m_levels.front()->queue.capacity();
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        size_t size = 0;
+        for (auto& level : m_levels)
+            size += level->queue.size();
+        return size;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Returns the level data is queued at.
+     */
+    [[nodiscard]] size_t levelOf(const T& data) const noexcept
+    {
+        return std::min(PriorityOf<T>::of(data), m_levels.size() - 1);
+    }
+
+    /**
+     * @brief Moves data into its level, unless that is full.
+     *
+     * @return False if the level is full, data is left untouched then.
+     */
+    bool tryPush(T&& data) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        return m_levels[levelOf(data)]->queue.tryEmplace(std::move(data),
+                                                         Clock::now());
+    }
+
+    /**
+     * @brief Takes the oldest element of the most urgent non-empty level, or of
+     * a level that waited too long.
+     */
+    std::optional<T> tryPop() noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        for (size_t i = m_levels.size(); i-- > 0;) {
+            if (m_levels[i]->queue.empty())
+                continue;
+
+            // the lower levels waiting behind this one are passed over
+            for (size_t lower = 0; lower < i; ++lower) {
+                Level& level = *m_levels[lower];
+                if (m_starvationLimit == 0 || level.queue.empty())
+                    continue;
+                if (level.skipped.fetch_add(1, std::memory_order_relaxed) + 1 >=
+                    m_starvationLimit) {
+                    if (auto out = popLevel(lower, true))
+                        return out;
+                }
+            }
+
+            if (auto out = popLevel(i, false))
+                return out;
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Takes the oldest element of the given level without accounting
+     * it, e.g. to drop it.
+     */
+    std::optional<T> tryPopLevel(size_t level) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        if (auto entry = m_levels[level]->queue.tryPop())
+            return std::move(entry->data);
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Returns the metrics of all levels, the least urgent one first.
+     */
+    [[nodiscard]] std::vector<PriorityMetrics> metrics() const
+    {
+        std::vector<PriorityMetrics> metrics;
+        metrics.reserve(m_levels.size());
+        for (auto& level : m_levels)
+            metrics.push_back(level->metrics());
+
+        return metrics;
+    }
+    void resetMetrics() noexcept
+    {
+        for (auto& level : m_levels)
+            level->resetMetrics();
+    }
+
+private:
+    struct Entry
+    {
+        Entry(T&& data, Clock::time_point pushed) noexcept(
+            std::is_nothrow_move_constructible<T>::value)
+            : data(std::move(data))
+            , pushed(pushed)
+        {}
+
+        T data;
+        Clock::time_point pushed;
+    };
+
+    /// latencies are counted in buckets of powers of two nanoseconds
+    static constexpr size_t numBuckets = 64;
+
+    struct Level
+    {
+        explicit Level(size_t capacity)
+            : queue(capacity)
+        {}
+
+        void add(Clock::duration latency, bool promoted) noexcept
+        {
+            auto ns = static_cast<uint64_t>(std::max<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(latency)
+                    .count(),
+                0));
+            size_t bucket = 0;
+            while (bucket + 1 < numBuckets && (ns >> bucket) > 1)
+                ++bucket;
+
+            counter.fetch_add(1, std::memory_order_relaxed);
+            if (promoted)
+                this->promoted.fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(ns, std::memory_order_relaxed);
+            uint64_t previous = max.load(std::memory_order_relaxed);
+            while (previous < ns &&
+                   !max.compare_exchange_weak(
+                       previous, ns, std::memory_order_relaxed)) {}
+            buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        PriorityMetrics metrics() const noexcept
+        {
+            PriorityMetrics metrics;
+            metrics.counter  = counter.load(std::memory_order_relaxed);
+            metrics.promoted = promoted.load(std::memory_order_relaxed);
+            if (metrics.counter == 0)
+                return metrics;
+
+            using std::chrono::nanoseconds;
+            metrics.meanLatency =
+                nanoseconds(total.load(std::memory_order_relaxed) /
+                            metrics.counter);
+            metrics.maxLatency =
+                nanoseconds(max.load(std::memory_order_relaxed));
+
+            // the bucket holding the 99th percentile
+            uint64_t rank  = metrics.counter - metrics.counter / 100;
+            uint64_t count = 0;
+            for (size_t bucket = 0; bucket < numBuckets; ++bucket) {
+                count += buckets[bucket].load(std::memory_order_relaxed);
+                if (count >= rank) {
+                    auto bound = nanoseconds(
+                        bucket + 1 < 64 ? uint64_t(1) << (bucket + 1)
+                                        : ~uint64_t(0) >> 1);
+                    metrics.p99Latency = std::min(bound, metrics.maxLatency);
+                    break;
+                }
+            }
+
+            return metrics;
+        }
+
+        void resetMetrics() noexcept
+        {
+            counter.store(0, std::memory_order_relaxed);
+            promoted.store(0, std::memory_order_relaxed);
+            total.store(0, std::memory_order_relaxed);
+            max.store(0, std::memory_order_relaxed);
+            for (auto& bucket : buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+
+        MpmcQueue<Entry> queue;
+        /// how often this level was passed over since it was last served
+        std::atomic<uint32_t> skipped{0};
+
+        std::atomic<uint64_t> counter{0};
+        std::atomic<uint64_t> promoted{0};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> max{0};
+        std::array<std::atomic<uint64_t>, numBuckets> buckets{};
+    };
+
+    std::optional<T> popLevel(size_t index, bool promoted) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        Level& level = *m_levels[index];
+        auto entry   = level.queue.tryPop();
+        if (!entry)
+            return std::nullopt;
+
+        level.skipped.store(0, std::memory_order_relaxed);
+        level.add(Clock::now() - entry->pushed, promoted);
+        return std::move(entry->data);
+    }
+
+private:
+    const uint32_t m_starvationLimit;
+    std::vector<std::unique_ptr<Level>> m_levels;
+};
+
+} // namespace blpl
@@ -0,0 +1,325 @@
+#pragma once
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "RecordFileSink is only implemented for POSIX systems"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Filter.h"
+#include "RecordView.h"
+
+namespace blpl {
+
+namespace detail {
+
+/**
+ * @brief Writes bytes to a file through a buffer of fixed size. In direct mode
+ * the buffer is aligned and only written in full blocks, bypassing the page
+ * cache where the system supports O_DIRECT.
+ *
+ * A failed write, e.g. on a full disk, is sticky: the writer drops everything
+ * written afterwards and good() stays false until the file is truncated.
+ */
+class RecordWriter
+{
+public:
+    static constexpr size_t blockSize = 4096;
+
+    RecordWriter(const std::string& path, size_t bufferSize, bool direct)
+        : m_path(path)
+        , m_direct(direct)
+    {
+        // direct I/O needs the buffer aligned to and sized in blocks
+        m_capacity = (bufferSize + blockSize - 1) / blockSize * blockSize;
+        if (m_capacity == 0)
+            m_capacity = blockSize;
+
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, blockSize, m_capacity) == 0)
+            m_buffer = static_cast<std::byte*>(buffer);
+
+        openFile();
+    }
+
+    ~RecordWriter()
+    {
+        close();
+        std::free(m_buffer);
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_fd >= 0 && m_buffer;
+    }
+
+    /**
+     * @brief Returns false if the file isn't open or a write to it failed.
+     */
+    [[nodiscard]] bool good() const noexcept
+    {
+        return isOpen() && !m_failed;
+    }
+
+    [[nodiscard]] uint64_t bytesWritten() const noexcept
+    {
+        return m_written + m_used;
+    }
+
+    void write(const std::byte* data, size_t size)
+    {
+        if (!good())
+            return;
+
+        while (size > 0) {
+            size_t chunk = std::min(size, m_capacity - m_used);
+            std::memcpy(m_buffer + m_used, data, chunk);
+            m_used += chunk;
+            data += chunk;
+            size -= chunk;
+
+            if (m_used == m_capacity)
+                writeBuffer(m_capacity);
+        }
+    }
+
+    /**
+     * @brief Writes everything that is buffered to the file.
+     *
+     * @return false if anything written to this file so far got lost.
+     */
+    bool flush()
+    {
+        if (!good())
+            return false;
+        if (m_used == 0)
+            return true;
+
+        if (!m_directFd) {
+            writeBuffer(m_used);
+            return good();
+        }
+
+        // pad the tail to full blocks, write it and cut the padding off again.
+        // The tail stays in the buffer, so later writes append correctly.
+        size_t used   = m_used;
+        size_t padded = (used + blockSize - 1) / blockSize * blockSize;
+        std::memset(m_buffer + used, 0, padded - used);
+        if (!writeAll(m_buffer, padded, m_written))
+            return false;
+        if (ftruncate(m_fd, static_cast<off_t>(m_written + used)) != 0) {
+            m_failed = true;
+            return false;
+        }
+
+        // keep the partial block at the front of the buffer
+        size_t fullBlocks = used / blockSize * blockSize;
+        std::memmove(m_buffer, m_buffer + fullBlocks, used - fullBlocks);
+        m_written += fullBlocks;
+        m_used = used - fullBlocks;
+
+        return true;
+    }
+
+    /**
+     * @brief Flushes and closes the file.
+     *
+     * @return false if anything written to this file got lost.
+     */
+    bool close()
+    {
+        if (m_fd < 0)
+            return false;
+
+        bool written = flush();
+        if (::close(m_fd) != 0 && errno != EINTR)
+            written = false;
+        m_fd = -1;
+
+        return written;
+    }
+
+    /**
+     * @brief Discards the buffer and truncates the file.
+     */
+    void truncate()
+    {
+        m_used    = 0;
+        m_written = 0;
+        m_failed  = false;
+        if (m_fd >= 0)
+            ::close(m_fd);
+        openFile();
+    }
+
+private:
+    void openFile()
+    {
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        m_directFd = false;
+#ifdef O_DIRECT
+        if (m_direct) {
+            m_fd = open(m_path.c_str(), flags | O_DIRECT, 0644);
+            // not every file system supports direct I/O
+            m_directFd = m_fd >= 0;
+            if (m_directFd)
+                return;
+        }
+#endif
+        m_fd = open(m_path.c_str(), flags, 0644);
+    }
+
+    void writeBuffer(size_t size)
+    {
+        writeAll(m_buffer, size, m_written);
+        m_written += size;
+        m_used = 0;
+    }
+
+    /// retries interrupted and short writes, marks the writer failed on errors
+    bool writeAll(const std::byte* data, size_t size, uint64_t offset)
+    {
+        while (size > 0) {
+            ssize_t result =
+                pwrite(m_fd, data, size, static_cast<off_t>(offset));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0) {
+                m_failed = true;
+                return false;
+            }
+            data += result;
+            offset += static_cast<uint64_t>(result);
+            size -= static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+private:
+    std::string m_path;
+    bool m_direct;
+    bool m_directFd = false;
+    int m_fd        = -1;
+    bool m_failed   = false;
+
+    std::byte* m_buffer = nullptr;
+    size_t m_capacity   = 0;
+    size_t m_used       = 0;
+    uint64_t m_written  = 0;
+};
+
+} // namespace detail
+
+/**
+ * @brief Sink filter that writes the incoming records to a file, optionally
+ * prefixed with their length so MappedRecordSource can read them back.
+ *
+ * Records are collected in a buffer that is written whenever it is full, when
+ * flush() is called and when the last copy of the filter is destroyed. The
+ * output of the filter is the total number of bytes written so far.
+ *
+ * Empty records are skipped, so a sink behind a MappedRecordSource stops
+ * writing once the source reached the end of its file.
+ */
+class RecordFileSink : public Filter<RecordView, uint64_t>
+{
+public:
+    enum class Mode
+    {
+        /// write through the page cache
+        Buffered,
+        /// bypass the page cache with O_DIRECT where available, falls back to
+        /// buffered writes if the file system doesn't support it
+        Direct
+    };
+
+    explicit RecordFileSink(const std::string& path,
+                            bool lengthPrefixed = false,
+                            Mode mode           = Mode::Buffered,
+                            size_t bufferSize   = 1 << 20)
+        : m_writer(std::make_shared<detail::RecordWriter>(
+              path, bufferSize, mode == Mode::Direct))
+        , m_lengthPrefixed(lengthPrefixed)
+    {}
+
+    /**
+     * @brief Returns false if the file could not be opened.
+     */
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_writer->isOpen();
+    }
+
+    /**
+     * @brief Returns false if the file could not be opened or writing to it
+     * failed, e.g. because the disk is full. Records passed in afterwards are
+     * dropped until the filter is reset.
+     */
+    [[nodiscard]] bool good() const noexcept
+    {
+        return m_writer->good();
+    }
+
+    /**
+     * @brief Writes all buffered records to the file.
+     *
+     * @return false if any record written to the file so far got lost.
+     */
+    bool flush()
+    {
+        return m_writer->flush();
+    }
+
+    /**
+     * @brief Writes all buffered records and closes the file. Records passed
+     * in afterwards are dropped until the filter is reset.
+     *
+     * @return false if any record written to the file got lost.
+     */
+    bool close()
+    {
+        return m_writer->close();
+    }
+
+    /**
+     * @brief Truncates the file and discards all buffered records.
+     */
+    void reset() override
+    {
+        m_writer->truncate();
+    }
+
+protected:
+    uint64_t processImpl(RecordView&& in) override
+    {
+        if (in.size() == 0)
+            return m_writer->bytesWritten();
+
+        if (m_lengthPrefixed) {
+            auto size = static_cast<std::uint32_t>(in.size());
+            m_writer->write(reinterpret_cast<const std::byte*>(&size),
+                            sizeof(size));
+        }
+        m_writer->write(in.data(), in.size());
+
+        return m_writer->bytesWritten();
+    }
+
+private:
+    std::shared_ptr<detail::RecordWriter> m_writer;
+    bool m_lengthPrefixed;
+};
+
+} // namespace blpl
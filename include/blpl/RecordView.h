@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace blpl {
+
+/**
+ * @brief Non-owning view of one record of raw bytes, e.g. inside a memory
+ * mapped file.
+ *
+ * The view is only valid as long as the memory it points to, see the filter
+ * that produced it. An empty view marks the end of a stream of records.
+ */
+class RecordView
+{
+public:
+    RecordView() noexcept = default;
+    RecordView(const std::byte* data, size_t size) noexcept
+        : m_data(data)
+        , m_size(size)
+    {}
+    RecordView(const void* data, size_t size) noexcept
+        : m_data(static_cast<const std::byte*>(data))
+        , m_size(size)
+    {}
+
+    [[nodiscard]] const std::byte* data() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_size;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] const std::byte* begin() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] const std::byte* end() const noexcept
+    {
+        return m_data + m_size;
+    }
+
+    [[nodiscard]] std::string_view asStringView() const noexcept
+    {
+        return {reinterpret_cast<const char*>(m_data), m_size};
+    }
+
+private:
+    const std::byte* m_data = nullptr;
+    size_t m_size           = 0;
+};
+
+} // namespace blpl
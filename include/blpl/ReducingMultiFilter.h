@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Filter.h"
+#include "Generator.h"
+#include "MultiFilter.h"
+#include "Tracer.h"
+#include "Uninitialized.h"
+
+namespace blpl {
+
+/**
+ * @brief Runs its sub-filters in lockstep like a MultiFilter, but instead of a
+ * vector it emits the results combined into a single OutData.
+ *
+ * The results are combined in a tree by the threads that produced them: in
+ * the first round every second lane merges the result of its neighbour, in
+ * the next round every fourth lane and so on, so n results are reduced in
+ * log2(n) rounds. The combine function has to be associative and is called
+ * from several threads at once.
+ *
+ * If the input has fewer elements than there are sub-filters, only as many
+ * sub-filters as there are elements run. An empty input results in a default
+ * constructed OutData, or throws std::invalid_argument if there is none.
+ *
+ * If a sub-filter or the combine function throws, the lanes stop merging, the
+ * partial results are dropped and the first exception is passed on.
+ *
+ * @tparam Combine Type of the callable, has to be invocable with two OutData&&
+ * and return something convertible to OutData.
+ */
+template <class InData,
+          class OutData,
+          class Combine = std::function<OutData(OutData&&, OutData&&)>>
+class ReducingMultiFilter : public Filter<std::vector<InData>, OutData>
+{
+    static_assert(
+        std::is_invocable_r<OutData, const Combine&, OutData&&, OutData&&>::
+            value,
+        "Combine has to be callable with two OutData&& and return OutData");
+
+public:
+    ReducingMultiFilter(const MultiFilter<InData, OutData>& lanes,
+                        Combine combine)
+        : m_filters(lanes.filters())
+        , m_combine(std::move(combine))
+    {
+        allocate();
+    }
+
+    ReducingMultiFilter(const ReducingMultiFilter& other)
+        : Filter<std::vector<InData>, OutData>(other)
+        , m_filters(other.m_filters)
+        , m_combine(other.m_combine)
+    {
+        allocate();
+    }
+
+    [[nodiscard]] bool isMultiFilter() const noexcept override
+    {
+        return true;
+    }
+    [[nodiscard]] size_t numParallel() const noexcept override
+    {
+        return m_filters.size();
+    }
+
+    void reset() noexcept override
+    {
+        for (auto& filter : m_filters)
+            filter->reset();
+    }
+
+    const std::type_info& getInDataTypeInfo() const noexcept override
+    {
+        return typeid(InData);
+    }
+
+protected:
+    OutData processImpl(std::vector<InData>&& in) override;
+
+private:
+    void allocate();
+    std::exception_ptr runLane(std::vector<InData>& in,
+                               size_t lane,
+                               size_t numLanes,
+                               std::vector<char>& holding,
+                               std::atomic<bool>& failed) noexcept;
+
+private:
+    std::vector<FilterPtr<InData, OutData>> m_filters;
+    Combine m_combine;
+
+    /// partial results of the lanes
+    std::unique_ptr<Uninitialized<OutData>[]> m_results;
+    /// set once the partial result of the lane is final
+    std::unique_ptr<std::atomic<bool>[]> m_ready;
+
+    /// tracks the lanes running in their own thread are traced on
+    std::vector<uint32_t> m_traceTracks;
+};
+
+/**
+ * @brief Creates a ReducingMultiFilter that stores combine by its concrete
+ * type.
+ */
+template <class InData, class OutData, class Combine>
+ReducingMultiFilter<InData, OutData, std::decay_t<Combine>>
+makeReducingMultiFilter(const MultiFilter<InData, OutData>& lanes,
+                        Combine&& combine)
+{
+    return {lanes, std::forward<Combine>(combine)};
+}
+
+template <class InData, class OutData, class Combine>
+void ReducingMultiFilter<InData, OutData, Combine>::allocate()
+{
+    m_results.reset(new Uninitialized<OutData>[m_filters.size()]);
+    m_ready.reset(new std::atomic<bool>[m_filters.size()]);
+}
+
+template <class InData, class OutData, class Combine>
+OutData
+ReducingMultiFilter<InData, OutData, Combine>::processImpl(
+    std::vector<InData>&& in)
+{
+    assert(!m_filters.empty());
+    size_t numLanes = m_filters.size();
+    if constexpr (!std::is_same<InData, Generator>()) {
+        numLanes = std::min(numLanes, in.size());
+        if (numLanes == 0) {
+            if constexpr (std::is_default_constructible<OutData>::value)
+                return OutData();
+            else
+                throw std::invalid_argument(
+                    "ReducingMultiFilter: no result for an empty input");
+        }
+    }
+
+    for (size_t i = 0; i < numLanes; ++i)
+        m_ready[i].store(false, std::memory_order_relaxed);
+
+    const bool tracing = Tracer::isEnabled();
+    if (tracing && m_traceTracks.size() != m_filters.size()) {
+        std::string name = Tracer::demangle(typeid(*this).name());
+        m_traceTracks.resize(m_filters.size());
+        for (size_t i = 0; i < m_filters.size(); ++i)
+            m_traceTracks[i] =
+                Tracer::registerTrack(name + " lane " + std::to_string(i));
+    }
+
+    // which lanes hold a partial result, each entry is written by the lane
+    // owning the result until it is ready and by its merging lane afterwards
+    std::vector<char> holding(numLanes, false);
+    std::vector<std::exception_ptr> errors(numLanes);
+    std::atomic<bool> failed{false};
+
+    // run all lanes but the first in their own thread
+    std::vector<std::thread> threads;
+    threads.reserve(numLanes - 1);
+    for (size_t i = 1; i < numLanes; ++i)
+        threads.emplace_back([this,
+                              &in,
+                              &holding,
+                              &errors,
+                              &failed,
+                              i,
+                              numLanes,
+                              track = tracing ? m_traceTracks[i] : 0] {
+            Tracer::setTrack(track);
+            errors[i] = runLane(in, i, numLanes, holding, failed);
+        });
+
+    // the first lane ends up with the complete result
+    errors[0] = runLane(in, 0, numLanes, holding, failed);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    if (failed) {
+        for (size_t i = 0; i < numLanes; ++i) {
+            if (holding[i])
+                m_results[i].destroy();
+        }
+        for (auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    return m_results[0].take();
+}
+
+/**
+ * @brief Processes the input of the lane and combines the results of the
+ * lanes it is responsible for.
+ *
+ * @return The exception the sub-filter or the combine function threw. The lane
+ * is marked ready anyway, the lanes waiting for it stop merging then.
+ */
+template <class InData, class OutData, class Combine>
+std::exception_ptr ReducingMultiFilter<InData, OutData, Combine>::runLane(
+    std::vector<InData>& in,
+    size_t lane,
+    size_t numLanes,
+    std::vector<char>& holding,
+    std::atomic<bool>& failed) noexcept
+{
+    std::exception_ptr error;
+    try {
+        if constexpr (std::is_same<InData, Generator>())
+            m_results[lane].construct(m_filters[lane]->process(Generator()));
+        else
+            m_results[lane].construct(
+                m_filters[lane]->process(std::move(in[lane])));
+        holding[lane] = true;
+
+        for (size_t stride = 1; stride < numLanes; stride *= 2) {
+            // this lane's result is merged by another one in this round
+            if (lane % (2 * stride) != 0)
+                break;
+
+            size_t partner = lane + stride;
+            if (partner >= numLanes)
+                continue;
+
+            while (!m_ready[partner].load(std::memory_order_acquire))
+                std::this_thread::yield();
+            if (failed.load(std::memory_order_relaxed))
+                break;
+
+            OutData first = m_results[lane].take();
+            holding[lane] = false;
+            OutData second = m_results[partner].take();
+            holding[partner] = false;
+            m_results[lane].construct(std::invoke(
+                std::as_const(m_combine), std::move(first), std::move(second)));
+            holding[lane] = true;
+        }
+    } catch (...) {
+        error = std::current_exception();
+        failed.store(true, std::memory_order_relaxed);
+    }
+
+    m_ready[lane].store(true, std::memory_order_release);
+    return error;
+}
+
+} // namespace blpl
@@ -0,0 +1,373 @@
+#pragma once
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "Replay is only implemented for POSIX systems"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "Filter.h"
+#include "MappedRecordSource.h"
+#include "Pipeline.h"
+#include "RecordFileSink.h"
+#include "RecordView.h"
+#include "Serializer.h"
+
+namespace blpl {
+
+namespace detail {
+
+/// replay logs start with this magic, followed by the format version
+constexpr char replayLogMagic[8]    = {'B', 'L', 'P', 'L', 'R', 'P', 'L', 'Y'};
+constexpr uint32_t replayLogVersion = 1;
+constexpr size_t replayLogHeaderSize =
+    sizeof(replayLogMagic) + sizeof(replayLogVersion);
+
+/// each record is prefixed with its timestamp in ns and its size
+constexpr size_t replayRecordHeaderSize = sizeof(int64_t) + sizeof(uint32_t);
+
+} // namespace detail
+
+/**
+ * @brief Filter that records every input of the filter it wraps into a replay
+ * log before handing it on, see ReplayDriver to feed the log back.
+ *
+ * The log is an append-only binary file: a header followed by one record per
+ * input, made of the time since the start of the recording in nanoseconds, the
+ * size of the payload and the payload as written by Serializer<InData>. All
+ * numbers are in host byte order.
+ *
+ * The log is written through a buffer, call flush() to write it out before
+ * reading the log while recording. Copies of the filter share the wrapped
+ * filter and the log.
+ */
+template <class InData, class OutData>
+class RecordingFilter : public Filter<InData, OutData>
+{
+public:
+    RecordingFilter(std::shared_ptr<Filter<InData, OutData>> filter,
+                    const std::string& path,
+                    size_t bufferSize = 1 << 20)
+        : m_filter(std::move(filter))
+        , m_log(std::make_shared<Log>(path, bufferSize))
+    {}
+
+    /**
+     * @brief Returns false if the log could not be opened.
+     */
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_log->writer.isOpen();
+    }
+
+    /**
+     * @brief Returns false if the log could not be opened or writing to it
+     * failed, later inputs aren't recorded then.
+     */
+    [[nodiscard]] bool good() const
+    {
+        std::scoped_lock<std::mutex> lock(m_log->mutex);
+        return m_log->writer.good();
+    }
+
+    /**
+     * @brief Returns the number of inputs recorded so far.
+     */
+    [[nodiscard]] uint64_t recorded() const
+    {
+        std::scoped_lock<std::mutex> lock(m_log->mutex);
+        return m_log->recorded;
+    }
+
+    /**
+     * @brief Writes all buffered records to the log.
+     *
+     * @return false if any record written to the log so far got lost.
+     */
+    bool flush()
+    {
+        std::scoped_lock<std::mutex> lock(m_log->mutex);
+        return m_log->writer.flush();
+    }
+
+    /**
+     * @brief Resets the wrapped filter, the log keeps recording.
+     */
+    void reset() override
+    {
+        m_filter->reset();
+    }
+
+protected:
+    OutData processImpl(InData&& in) override
+    {
+        record(in);
+        return m_filter->process(std::move(in));
+    }
+
+private:
+    void record(const InData& in)
+    {
+        std::scoped_lock<std::mutex> lock(m_log->mutex);
+        auto& buffer = m_log->buffer;
+        buffer.clear();
+        Serializer<InData>::serialize(in, buffer);
+
+        int64_t timestamp =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_log->start)
+                .count();
+        auto size = static_cast<uint32_t>(buffer.size());
+
+        auto& writer = m_log->writer;
+        writer.write(reinterpret_cast<const std::byte*>(&timestamp),
+                     sizeof(timestamp));
+        writer.write(reinterpret_cast<const std::byte*>(&size), sizeof(size));
+        writer.write(reinterpret_cast<const std::byte*>(buffer.data()),
+                     buffer.size());
+        ++m_log->recorded;
+    }
+
+    struct Log
+    {
+        Log(const std::string& path, size_t bufferSize)
+            : writer(path, bufferSize, false)
+        {
+            writer.write(reinterpret_cast<const std::byte*>(
+                             detail::replayLogMagic),
+                         sizeof(detail::replayLogMagic));
+            writer.write(reinterpret_cast<const std::byte*>(
+                             &detail::replayLogVersion),
+                         sizeof(detail::replayLogVersion));
+        }
+
+        std::mutex mutex;
+        detail::RecordWriter writer;
+        /// reused for serializing the inputs
+        std::string buffer;
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        uint64_t recorded = 0;
+    };
+
+private:
+    std::shared_ptr<Filter<InData, OutData>> m_filter;
+    std::shared_ptr<Log> m_log;
+};
+
+/**
+ * @brief Creates a RecordingFilter that records the inputs of filter.
+ */
+template <class FilterType>
+RecordingFilter<typename FilterType::inType, typename FilterType::outType>
+makeRecordingFilter(std::shared_ptr<FilterType> filter,
+                    const std::string& path)
+{
+    return {std::move(filter), path};
+}
+
+/**
+ * @brief Reads the records of a replay log from a memory mapping.
+ */
+class ReplayLog
+{
+public:
+    struct Record
+    {
+        /// time since the start of the recording
+        std::chrono::nanoseconds timestamp;
+        /// the serialized input, points into the mapping of the log
+        RecordView data;
+    };
+
+    explicit ReplayLog(const std::string& path)
+        : m_file(std::make_shared<detail::MappedFile>(path))
+    {}
+
+    /**
+     * @brief Returns false if the file could not be opened or is no replay log
+     * of a supported version.
+     */
+    [[nodiscard]] bool isValid() const noexcept
+    {
+        if (m_file->size() < detail::replayLogHeaderSize)
+            return false;
+
+        uint32_t version;
+        std::memcpy(&version,
+                    m_file->data() + sizeof(detail::replayLogMagic),
+                    sizeof(version));
+        return std::memcmp(m_file->data(),
+                           detail::replayLogMagic,
+                           sizeof(detail::replayLogMagic)) == 0 &&
+               version == detail::replayLogVersion;
+    }
+
+    /**
+     * @brief Returns the next record, nothing at the end of the log. A
+     * truncated record at the end is ignored.
+     */
+    std::optional<Record> next() noexcept
+    {
+        if (!isValid())
+            return std::nullopt;
+
+        size_t remaining = m_file->size() - m_offset;
+        if (remaining < detail::replayRecordHeaderSize)
+            return std::nullopt;
+
+        int64_t timestamp;
+        uint32_t size;
+        const std::byte* header = m_file->data() + m_offset;
+        std::memcpy(&timestamp, header, sizeof(timestamp));
+        std::memcpy(&size, header + sizeof(timestamp), sizeof(size));
+        if (remaining - detail::replayRecordHeaderSize < size)
+            return std::nullopt;
+
+        Record record{std::chrono::nanoseconds(timestamp),
+                      RecordView(header + detail::replayRecordHeaderSize,
+                                 size)};
+        m_offset += detail::replayRecordHeaderSize + size;
+
+        return record;
+    }
+
+    /**
+     * @brief Starts over at the first record.
+     */
+    void rewind() noexcept
+    {
+        m_offset = detail::replayLogHeaderSize;
+    }
+
+private:
+    std::shared_ptr<const detail::MappedFile> m_file;
+    size_t m_offset = detail::replayLogHeaderSize;
+};
+
+/**
+ * @brief Pace at which a ReplayDriver feeds the recorded inputs.
+ */
+enum class ReplayRate
+{
+    /// keep the time between the inputs as recorded
+    Original,
+    /// feed the inputs as fast as they are taken
+    Maximum
+};
+
+/**
+ * @brief Feeds the inputs recorded by a RecordingFilter back into a filter, a
+ * pipeline or any other consumer, e.g. to benchmark a filter with production
+ * traffic.
+ *
+ * Records that Serializer<InData> can't deserialize are skipped and counted.
+ */
+template <class InData>
+class ReplayDriver
+{
+public:
+    explicit ReplayDriver(const std::string& path,
+                          ReplayRate rate = ReplayRate::Original)
+        : m_log(path)
+        , m_rate(rate)
+    {}
+
+    [[nodiscard]] bool isValid() const noexcept
+    {
+        return m_log.isValid();
+    }
+
+    /**
+     * @brief Returns the number of records that couldn't be deserialized.
+     */
+    [[nodiscard]] uint64_t malformed() const noexcept
+    {
+        return m_malformed;
+    }
+
+    /**
+     * @brief Calls consume with every recorded input, from the beginning of
+     * the log. Stops early if consume returns false.
+     *
+     * @return The number of inputs consume took.
+     */
+    template <class Consumer>
+    uint64_t replay(Consumer&& consume);
+
+    /**
+     * @brief Processes every recorded input with filter, discarding the
+     * outputs.
+     */
+    template <class OutData>
+    uint64_t replayInto(Filter<InData, OutData>& filter)
+    {
+        return replay([&filter](InData&& in) {
+            filter.process(std::move(in));
+            return true;
+        });
+    }
+
+    /**
+     * @brief Pushes every recorded input into the in pipe of pipeline without
+     * dropping any. Stops early if the pipeline gets stopped.
+     */
+    template <class OutData>
+    uint64_t replayInto(Pipeline<InData, OutData>& pipeline)
+    {
+        return replay([&pipeline](InData&& in) {
+            while (!pipeline.pushFor(std::move(in),
+                                     std::chrono::milliseconds(100))) {
+                if (!pipeline.inPipe()->isEnabled())
+                    return false;
+            }
+            return true;
+        });
+    }
+
+private:
+    ReplayLog m_log;
+    ReplayRate m_rate;
+    uint64_t m_malformed = 0;
+};
+
+template <class InData>
+template <class Consumer>
+uint64_t ReplayDriver<InData>::replay(Consumer&& consume)
+{
+    m_log.rewind();
+    uint64_t replayed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::nanoseconds> firstTimestamp;
+    while (auto record = m_log.next()) {
+        auto in = Serializer<InData>::deserialize(record->data);
+        if (!in) {
+            ++m_malformed;
+            continue;
+        }
+
+        if (m_rate == ReplayRate::Original) {
+            if (!firstTimestamp)
+                firstTimestamp = record->timestamp;
+            std::this_thread::sleep_until(start + record->timestamp -
+                                          *firstTimestamp);
+        }
+
+        if (!consume(std::move(*in)))
+            break;
+        ++replayed;
+    }
+
+    return replayed;
+}
+
+} // namespace blpl
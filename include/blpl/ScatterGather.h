@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "Filter.h"
+#include "Span.h"
+
+namespace blpl {
+
+namespace detail {
+
+/**
+ * @brief The buffers a ScatterFilter partitions, shared by all partitions.
+ */
+template <class In, class Out>
+struct PartitionedBuffers
+{
+    std::vector<In> input;
+    std::vector<Out> output;
+};
+
+} // namespace detail
+
+/**
+ * @brief One part of a buffer split up by a ScatterFilter: a view of a slice of
+ * the input and a view of the corresponding slice of the output, into which
+ * the sub-filter writes its results.
+ *
+ * The partition keeps the buffers alive, so it can be passed through the
+ * pipeline like any other payload.
+ */
+template <class In, class Out>
+class Partition
+{
+public:
+    Partition() = default;
+    Partition(std::shared_ptr<detail::PartitionedBuffers<In, Out>> buffers,
+              Span<const In> in,
+              Span<Out> out,
+              size_t offset) noexcept
+        : m_buffers(std::move(buffers))
+        , m_in(in)
+        , m_out(out)
+        , m_offset(offset)
+    {}
+
+    /**
+     * @brief Returns the slice of the input. In place partitions alias it with
+     * the output.
+     */
+    [[nodiscard]] Span<const In> in() const noexcept
+    {
+        return m_in;
+    }
+    [[nodiscard]] Span<Out> out() const noexcept
+    {
+        return m_out;
+    }
+
+    /**
+     * @brief Returns the position of the slice in the whole buffer.
+     */
+    [[nodiscard]] size_t offset() const noexcept
+    {
+        return m_offset;
+    }
+
+private:
+    std::shared_ptr<detail::PartitionedBuffers<In, Out>> m_buffers;
+    Span<const In> m_in;
+    Span<Out> m_out;
+    size_t m_offset = 0;
+
+    template <class, class>
+    friend class GatherFilter;
+};
+
+/**
+ * @brief Splits a contiguous buffer into views for the sub-filters of a
+ * following MultiFilter without copying it.
+ *
+ * Together with each slice of the input, the sub-filters get the matching
+ * slice of an output buffer that is allocated once per element, so they can
+ * write their results in place. A GatherFilter after the MultiFilter hands the
+ * output buffer on as a whole.
+ *
+ * @tparam In Type of the elements of the input buffer.
+ * @tparam Out Type of the elements of the output buffer, which has the same
+ * length as the input.
+ */
+template <class In, class Out = In>
+class ScatterFilter
+    : public Filter<std::vector<In>, std::vector<Partition<In, Out>>>
+{
+public:
+    /**
+     * @param numPartitions Number of partitions, i.e. the number of sub-filters
+     * of the MultiFilter.
+     * @param granularity Partitions but the last one are a multiple of this
+     * many elements, e.g. the width of an image to only split between rows.
+     * @param inPlace Let the sub-filters overwrite the input instead of
+     * allocating an output buffer, only possible if In and Out are the same.
+     */
+    explicit ScatterFilter(size_t numPartitions,
+                           size_t granularity = 1,
+                           bool inPlace       = false)
+        : m_numPartitions(numPartitions > 0 ? numPartitions : 1)
+        , m_granularity(granularity > 0 ? granularity : 1)
+        , m_inPlace(inPlace)
+    {
+        static_assert(std::is_default_constructible<Out>::value,
+                      "The output buffer is allocated with default "
+                      "constructed elements");
+    }
+
+protected:
+    std::vector<Partition<In, Out>> processImpl(std::vector<In>&& in) override
+    {
+        auto buffers = std::make_shared<detail::PartitionedBuffers<In, Out>>();
+        buffers->input = std::move(in);
+
+        Span<const In> input(buffers->input.data(), buffers->input.size());
+        Span<Out> output;
+        if constexpr (std::is_same<In, Out>::value) {
+            if (m_inPlace)
+                output = {buffers->input.data(), buffers->input.size()};
+        }
+        if (!isInPlace()) {
+            buffers->output.resize(buffers->input.size());
+            output = {buffers->output.data(), buffers->output.size()};
+        }
+
+        // spread the blocks of granularity elements evenly
+        const size_t size      = input.size();
+        const size_t numBlocks = (size + m_granularity - 1) / m_granularity;
+        auto boundary          = [&](size_t i) {
+            return std::min(size,
+                            numBlocks * i / m_numPartitions * m_granularity);
+        };
+
+        std::vector<Partition<In, Out>> partitions;
+        partitions.reserve(m_numPartitions);
+        for (size_t i = 0; i < m_numPartitions; ++i) {
+            size_t begin = boundary(i);
+            size_t end   = boundary(i + 1);
+            partitions.emplace_back(buffers,
+                                    input.subspan(begin, end - begin),
+                                    output.subspan(begin, end - begin),
+                                    begin);
+        }
+
+        return partitions;
+    }
+
+private:
+    bool isInPlace() const noexcept
+    {
+        return std::is_same<In, Out>::value && m_inPlace;
+    }
+
+private:
+    size_t m_numPartitions;
+    size_t m_granularity;
+    bool m_inPlace;
+};
+
+/**
+ * @brief Counterpart of ScatterFilter: takes the partitions after the
+ * MultiFilter wrote to them and hands on the whole output buffer without
+ * copying it.
+ */
+template <class In, class Out = In>
+class GatherFilter
+    : public Filter<std::vector<Partition<In, Out>>, std::vector<Out>>
+{
+protected:
+    std::vector<Out> processImpl(std::vector<Partition<In, Out>>&& in) override
+    {
+        if (in.empty() || !in.front().m_buffers)
+            return {};
+
+        auto buffers = std::move(in.front().m_buffers);
+        in.clear();
+
+        // in place partitions wrote into the input buffer
+        if constexpr (std::is_same<In, Out>::value) {
+            if (buffers->output.size() != buffers->input.size())
+                return std::move(buffers->input);
+        }
+        return std::move(buffers->output);
+    }
+};
+
+} // namespace blpl
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "RecordView.h"
+
+namespace blpl {
+
+/**
+ * @brief Converts payloads to bytes and back, used to record and replay the
+ * inputs of filters.
+ *
+ * Specialize it for your payloads with two static functions:
+ * - void serialize(const T& value, std::string& out), appending the bytes of
+ *   value to out
+ * - std::optional<T> deserialize(RecordView in), returning nothing if in is
+ *   malformed
+ *
+ * Trivially copyable types, std::string and vectors of trivially copyable
+ * types are supported out of the box, byte for byte in host byte order.
+ */
+template <class T, class = void>
+struct Serializer;
+
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_trivially_copyable<T>::value>>
+{
+    static_assert(std::is_default_constructible<T>::value,
+                  "Specialize Serializer to deserialize this type");
+
+    static void serialize(const T& value, std::string& out)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static std::optional<T> deserialize(RecordView in)
+    {
+        if (in.size() != sizeof(T))
+            return std::nullopt;
+
+        T value;
+        std::memcpy(&value, in.data(), sizeof(T));
+        return value;
+    }
+};
+
+template <>
+struct Serializer<std::string>
+{
+    static void serialize(const std::string& value, std::string& out)
+    {
+        out.append(value);
+    }
+
+    static std::optional<std::string> deserialize(RecordView in)
+    {
+        return std::string(in.asStringView());
+    }
+};
+
+template <class T>
+struct Serializer<std::vector<T>,
+                  std::enable_if_t<std::is_trivially_copyable<T>::value>>
+{
+    static void serialize(const std::vector<T>& value, std::string& out)
+    {
+        out.append(reinterpret_cast<const char*>(value.data()),
+                   value.size() * sizeof(T));
+    }
+
+    static std::optional<std::vector<T>> deserialize(RecordView in)
+    {
+        if (in.size() % sizeof(T) != 0)
+            return std::nullopt;
+
+        std::vector<T> value(in.size() / sizeof(T));
+        if (!value.empty())
+            std::memcpy(value.data(), in.data(), in.size());
+        return value;
+    }
+};
+
+} // namespace blpl
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+namespace blpl {
+
+/**
+ * @brief Non-owning view of a contiguous range of elements, a minimal stand-in
+ * for std::span as long as the library targets C++17.
+ */
+template <class T>
+class Span
+{
+public:
+    Span() noexcept = default;
+    Span(T* data, size_t size) noexcept
+        : m_data(data)
+        , m_size(size)
+    {}
+
+    /// allows converting a Span<T> to a Span<const T>
+    template <class U,
+              class = std::enable_if_t<
+                  std::is_convertible<U (*)[], T (*)[]>::value>>
+    Span(const Span<U>& other) noexcept
+        : m_data(other.data())
+        , m_size(other.size())
+    {}
+
+    [[nodiscard]] T* data() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_size;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] T* begin() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] T* end() const noexcept
+    {
+        return m_data + m_size;
+    }
+
+    T& operator[](size_t i) const noexcept
+    {
+        assert(i < m_size);
+        return m_data[i];
+    }
+
+    /**
+     * @brief Returns the view of count elements starting at offset.
+     */
+    [[nodiscard]] Span subspan(size_t offset, size_t count) const noexcept
+    {
+        assert(offset + count <= m_size);
+        return Span(m_data + offset, count);
+    }
+
+private:
+    T* m_data     = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace blpl
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "FilterError.h"
+#include "Pipe.h"
+
+namespace blpl {
+
+/**
+ * @brief Selects the pipe implementation for an edge of a StaticPipeline that
+ * carries data of type TData.
+ *
+ * Specialize this template to use a different pipe for a specific payload.
+ * The selected type has to provide the interface of Pipe.
+ */
+template <class TData>
+struct StaticPipeSelector
+{
+    using type = Pipe<TData>;
+};
+
+template <class TData>
+using StaticPipe = typename StaticPipeSelector<TData>::type;
+
+/**
+ * @brief A pipeline whose filters and pipes are fixed at compile time.
+ *
+ * In contrast to Pipeline, the filters are stored by value in a std::tuple and
+ * the pipes are chosen per edge through StaticPipeSelector. Filters are called
+ * through their qualified process() method, so there is no virtual dispatch
+ * through shared pointers or AbstractFilterThread and the compiler is free to
+ * inline across the whole stage. Declaring the filters `final` additionally
+ * allows it to devirtualize the call to processImpl().
+ *
+ * Every filter runs in its own thread that stays alive from start() to stop()
+ * and yields while waiting for input. All pipes but the last one are waiting
+ * pipes. Use pipe<I>() to change that for individual edges.
+ *
+ * An element whose filter throws is dropped and the thread goes on with the
+ * next one, see setErrorSink().
+ *
+ * @tparam Filters The types of the filters in the order of the data flow. Each
+ * type needs an inType and outType and a process(inType&&) method. The outType
+ * of a filter has to match the inType of the following one.
+ */
+template <class... Filters>
+class StaticPipeline
+{
+    static_assert(sizeof...(Filters) >= 2,
+                  "A pipeline needs at least two filters");
+
+    using FilterTuple = std::tuple<Filters...>;
+
+    template <size_t I>
+    using FilterAt = std::tuple_element_t<I, FilterTuple>;
+
+    static constexpr size_t N = sizeof...(Filters);
+
+public:
+    using inType  = typename FilterAt<0>::inType;
+    using outType = typename FilterAt<N - 1>::outType;
+
+private:
+    using PipeTuple = std::tuple<StaticPipe<inType>,
+                                 StaticPipe<typename Filters::outType>...>;
+
+public:
+    explicit StaticPipeline(Filters... filters);
+    ~StaticPipeline();
+
+    StaticPipeline(const StaticPipeline&) = delete;
+    StaticPipeline& operator=(const StaticPipeline&) = delete;
+
+    void start();
+    void stop();
+    void reset();
+
+    [[nodiscard]] bool isRunning() const noexcept
+    {
+        return m_running;
+    }
+
+    [[nodiscard]] static constexpr size_t length() noexcept
+    {
+        return N;
+    }
+
+    /// Returns the I-th filter of the pipeline.
+    template <size_t I>
+    FilterAt<I>& filter() noexcept
+    {
+        return std::get<I>(m_filters);
+    }
+
+    /// Returns the pipe in front of the I-th filter, pipe<length()>() is the
+    /// out pipe.
+    template <size_t I>
+    std::tuple_element_t<I, PipeTuple>& pipe() noexcept
+    {
+        return std::get<I>(m_pipes);
+    }
+
+    StaticPipe<inType>& inPipe() noexcept
+    {
+        return std::get<0>(m_pipes);
+    }
+
+    StaticPipe<outType>& outPipe() noexcept
+    {
+        return std::get<N>(m_pipes);
+    }
+
+    /**
+     * @brief Calls sink with each exception a filter throws while handling an
+     * element. FilterError::filter stays empty, as the filters are stored by
+     * value. Without a sink, errors are only counted.
+     *
+     * @note Only call this while the pipeline is stopped. sink is called on
+     * the thread of the failing filter.
+     */
+    void setErrorSink(std::function<void(const FilterError&)> sink)
+    {
+        m_errorSink = std::move(sink);
+    }
+
+    /// Returns the number of elements the filter of the given stage dropped
+    /// because it threw.
+    [[nodiscard]] uint64_t errors(size_t stage) const noexcept
+    {
+        return stage < N ? m_errors[stage].load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    template <size_t... Is>
+    static constexpr bool compatible(std::index_sequence<Is...>)
+    {
+        return (std::is_same<typename FilterAt<Is>::outType,
+                             typename FilterAt<Is + 1>::inType>::value &&
+                ...);
+    }
+
+    template <size_t I>
+    void run();
+
+    template <size_t... Is>
+    void startThreads(std::index_sequence<Is...>);
+
+    template <class Func>
+    void forEachPipe(Func&& func);
+
+    void reportError(size_t stage,
+                     uint64_t sequence,
+                     std::exception_ptr exception) noexcept;
+
+private:
+    FilterTuple m_filters;
+    PipeTuple m_pipes;
+
+    std::function<void(const FilterError&)> m_errorSink;
+    std::array<std::atomic<uint64_t>, N> m_errors{};
+
+    std::array<std::thread, N> m_threads;
+    std::atomic<bool> m_running;
+};
+
+template <class... Filters>
+StaticPipeline(Filters...) -> StaticPipeline<Filters...>;
+
+/**
+ * @brief Constructs the pipeline from the given filters, which are moved into
+ * the pipeline.
+ */
+template <class... Filters>
+StaticPipeline<Filters...>::StaticPipeline(Filters... filters)
+    : m_filters(std::move(filters)...)
+    , m_running(false)
+{
+    static_assert(compatible(std::make_index_sequence<N - 1>()),
+                  "Filters are incompatible");
+
+    // same configuration as the pipe operators: waiting pipes between the
+    // filters, discarding pipes at both ends
+    std::apply(
+        [](auto& in, auto&... rest) {
+            in.setWaitForSlowestFilter(false);
+            (rest.setWaitForSlowestFilter(true), ...);
+        },
+        m_pipes);
+    outPipe().setWaitForSlowestFilter(false);
+}
+
+/**
+ * @brief Destructor, stops the pipeline.
+ */
+template <class... Filters>
+StaticPipeline<Filters...>::~StaticPipeline()
+{
+    stop();
+}
+
+/**
+ * @brief Starts one thread per filter. Does nothing if already running.
+ */
+template <class... Filters>
+void StaticPipeline<Filters...>::start()
+{
+    if (m_running.exchange(true))
+        return;
+
+    forEachPipe([](auto& pipe) { pipe.enable(); });
+    startThreads(std::make_index_sequence<N>());
+}
+
+/**
+ * @brief Stops the pipes and waits for all the threads to finish up their last
+ * computation.
+ */
+template <class... Filters>
+void StaticPipeline<Filters...>::stop()
+{
+    m_running = false;
+    forEachPipe([](auto& pipe) { pipe.disable(); });
+
+    for (auto& thread : m_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+/**
+ * @brief Resets all filters and pipes and restarts the pipeline if it was
+ * running.
+ */
+template <class... Filters>
+void StaticPipeline<Filters...>::reset()
+{
+    bool stopAndRestart = m_running;
+    if (stopAndRestart)
+        stop();
+
+    std::apply([](auto&... filters) { (filters.reset(), ...); }, m_filters);
+    forEachPipe([](auto& pipe) { pipe.reset(); });
+
+    if (stopAndRestart)
+        start();
+}
+
+template <class... Filters>
+template <size_t... Is>
+void StaticPipeline<Filters...>::startThreads(std::index_sequence<Is...>)
+{
+    ((m_threads[Is] = std::thread(&StaticPipeline::run<Is>, this)), ...);
+}
+
+template <class... Filters>
+template <class Func>
+void StaticPipeline<Filters...>::forEachPipe(Func&& func)
+{
+    std::apply([&func](auto&... pipes) { (func(pipes), ...); }, m_pipes);
+}
+
+/**
+ * @brief The loop of the thread of the I-th filter.
+ */
+template <class... Filters>
+template <size_t I>
+void StaticPipeline<Filters...>::run()
+{
+    using FilterType = FilterAt<I>;
+
+    auto& filter  = std::get<I>(m_filters);
+    auto& inPipe  = std::get<I>(m_pipes);
+    auto& outPipe = std::get<I + 1>(m_pipes);
+
+    uint64_t sequence = 0;
+    while (m_running) {
+        auto in = inPipe.blockingTryPop();
+        if (!in || !m_running)
+            continue;
+
+        try {
+            // the qualified call prevents virtual dispatch
+            outPipe.push(filter.FilterType::process(std::move(*in)));
+        } catch (...) {
+            reportError(I, sequence, std::current_exception());
+        }
+        ++sequence;
+    }
+}
+
+/**
+ * @brief Counts an exception and hands it to the error sink, if any.
+ */
+template <class... Filters>
+void StaticPipeline<Filters...>::reportError(
+    size_t stage,
+    uint64_t sequence,
+    std::exception_ptr exception) noexcept
+{
+    m_errors[stage].fetch_add(1, std::memory_order_relaxed);
+    if (!m_errorSink)
+        return;
+
+    FilterError error;
+    error.stage     = stage;
+    error.sequence  = sequence;
+    error.exception = std::move(exception);
+    try {
+        m_errorSink(error);
+    } catch (...) {
+        // the sink must not take the thread down
+    }
+}
+
+} // namespace blpl
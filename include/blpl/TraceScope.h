@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace blpl {
+
+namespace detail {
+
+using TraceClock    = std::chrono::steady_clock;
+using TraceRecorder = void (*)(const char*,
+                               const char*,
+                               TraceClock::time_point,
+                               TraceClock::time_point);
+
+/// Tracer::record() while tracing is enabled, nullptr otherwise
+inline std::atomic<TraceRecorder> traceRecorder{nullptr};
+
+} // namespace detail
+
+/**
+ * @brief Records the lifetime of this object as event, if tracing is enabled.
+ *
+ * Kept apart from Tracer, so filters and pipes can be traced without pulling
+ * in what recording and exporting the events needs.
+ */
+class TraceScope
+{
+public:
+    /**
+     * @param category Category of the event, has to outlive the Tracer.
+     * @param name Name of the event, has to outlive the Tracer. Names from
+     * std::type_info are demangled on export.
+     */
+    TraceScope(const char* category, const char* name) noexcept
+        : m_category(category)
+        , m_name(name)
+        , m_record(detail::traceRecorder.load(std::memory_order_relaxed))
+    {
+        if (m_record)
+            m_begin = detail::TraceClock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (!m_record)
+            return;
+        try {
+            m_record(m_category, m_name, m_begin, detail::TraceClock::now());
+        } catch (...) {
+            // losing an event beats terminating
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    detail::TraceRecorder m_record;
+    detail::TraceClock::time_point m_begin;
+};
+
+} // namespace blpl
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+#include "TraceScope.h"
+
+namespace blpl {
+
+/**
+ * @brief Records a timeline of the pipeline execution that can be exported in
+ * the Chrome trace event format, which can be viewed in chrome://tracing or
+ * the Perfetto UI.
+ *
+ * Tracing is off by default, in which case every trace point only costs a
+ * relaxed atomic load. When enabled, each trace point records one begin/end
+ * event into a ring buffer owned by the recording thread, so recording doesn't
+ * need any locks and the oldest events get overwritten when the buffer is
+ * full. Events are shown on tracks: every FilterThread and every MultiFilter
+ * lane gets its own track, other threads get a track of their own.
+ *
+ * Disable tracing before exporting or clearing the events, the export doesn't
+ * synchronize with threads that are still recording.
+ */
+class Tracer
+{
+public:
+    using Clock = detail::TraceClock;
+
+    /**
+     * @brief Starts recording. The buffer size only affects buffers of threads
+     * that didn't record events yet, so set it before the pipeline starts.
+     */
+    static void enable(size_t eventsPerThread = 1 << 16)
+    {
+        auto& s = state();
+        {
+            std::scoped_lock<std::mutex> lock(s.mutex);
+            s.capacity = eventsPerThread > 0 ? eventsPerThread : 1;
+        }
+        detail::traceRecorder.store(&Tracer::record, std::memory_order_relaxed);
+    }
+
+    static void disable() noexcept
+    {
+        detail::traceRecorder.store(nullptr, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static bool isEnabled() noexcept
+    {
+        return detail::traceRecorder.load(std::memory_order_relaxed) != nullptr;
+    }
+
+    /**
+     * @brief Drops all recorded events.
+     */
+    static void clear()
+    {
+        auto& s = state();
+        std::scoped_lock<std::mutex> lock(s.mutex);
+        for (auto& buffer : s.buffers)
+            buffer->head.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Creates a new track with the given name and returns its id.
+     */
+    static uint32_t registerTrack(std::string name)
+    {
+        auto& s = state();
+        std::scoped_lock<std::mutex> lock(s.mutex);
+        s.trackNames.push_back(std::move(name));
+        return static_cast<uint32_t>(s.trackNames.size());
+    }
+
+    /**
+     * @brief Puts all events recorded by the calling thread from now on onto
+     * the given track.
+     */
+    static void setTrack(uint32_t track) noexcept
+    {
+        context().track = track;
+    }
+
+    /**
+     * @brief Records an event that started at begin and ended at end on the
+     * track of the calling thread. The strings have to outlive the tracer.
+     *
+     * Throws if the first event of a thread can't get a buffer.
+     */
+    static void record(const char* category,
+                       const char* name,
+                       Clock::time_point begin,
+                       Clock::time_point end)
+    {
+        auto& ctx = context();
+        if (!ctx.buffer)
+            acquireBuffer(ctx);
+
+        auto& buffer = *ctx.buffer;
+        uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % buffer.events.size()] = {
+            category, name, begin, end, ctx.track};
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Writes all recorded events as Chrome trace JSON.
+     */
+    static void writeChromeTrace(std::ostream& out);
+
+    /**
+     * @brief Writes all recorded events as Chrome trace JSON into the file at
+     * path. Returns false if the file could not be written.
+     */
+    static bool writeChromeTrace(const std::string& path)
+    {
+        std::ofstream file(path);
+        writeChromeTrace(file);
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * @brief Returns the human readable form of a name from std::type_info.
+     */
+    static std::string demangle(const char* name);
+
+private:
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        Clock::time_point begin;
+        Clock::time_point end;
+        uint32_t track;
+    };
+
+    struct Buffer
+    {
+        explicit Buffer(size_t capacity)
+            : events(capacity)
+        {}
+
+        std::vector<Event> events;
+        std::atomic<uint64_t> head{0};
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        std::vector<Buffer*> freeBuffers;
+        std::vector<std::string> trackNames;
+        size_t capacity         = 1 << 16;
+        Clock::time_point epoch = Clock::now();
+    };
+
+    /// Hands the buffer back when the thread ends, as FilterThreads come and go
+    /// all the time.
+    struct ThreadContext
+    {
+        ~ThreadContext()
+        {
+            if (buffer) {
+                auto& s = state();
+                std::scoped_lock<std::mutex> lock(s.mutex);
+                s.freeBuffers.push_back(buffer);
+            }
+        }
+
+        Buffer* buffer = nullptr;
+        uint32_t track = 0;
+    };
+
+    static State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    static ThreadContext& context() noexcept
+    {
+        thread_local ThreadContext ctx;
+        return ctx;
+    }
+
+    static void acquireBuffer(ThreadContext& ctx)
+    {
+        auto& s = state();
+        std::scoped_lock<std::mutex> lock(s.mutex);
+        if (!s.freeBuffers.empty()) {
+            ctx.buffer = s.freeBuffers.back();
+            s.freeBuffers.pop_back();
+        } else {
+            s.buffers.push_back(std::make_unique<Buffer>(s.capacity));
+            ctx.buffer = s.buffers.back().get();
+        }
+
+        if (ctx.track == 0) {
+            s.trackNames.push_back("thread " +
+                                   std::to_string(s.trackNames.size() + 1));
+            ctx.track = static_cast<uint32_t>(s.trackNames.size());
+        }
+    }
+
+    static void writeJsonString(std::ostream& out, const std::string& str);
+};
+
+inline std::string Tracer::demangle(const char* name)
+{
+#if __has_include(<cxxabi.h>)
+    int status      = 0;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && demangled) {
+        std::string result(demangled);
+        std::free(demangled);
+        return result;
+    }
+#endif
+    return name;
+}
+
+inline void Tracer::writeJsonString(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+inline void Tracer::writeChromeTrace(std::ostream& out)
+{
+    auto& s = state();
+    std::scoped_lock<std::mutex> lock(s.mutex);
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separate = [&out, &first] {
+        if (!first)
+            out << ",\n";
+        first = false;
+    };
+
+    for (size_t i = 0; i < s.trackNames.size(); ++i) {
+        separate();
+        out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << i + 1
+            << R"(,"args":{"name":)";
+        writeJsonString(out, s.trackNames[i]);
+        out << "}}";
+    }
+
+    for (auto& buffer : s.buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t size = buffer->events.size();
+        for (uint64_t i = head > size ? head - size : 0; i < head; ++i) {
+            const auto& event = buffer->events[i % size];
+            std::chrono::duration<double, std::micro> begin =
+                event.begin - s.epoch;
+            std::chrono::duration<double, std::micro> duration =
+                event.end - event.begin;
+
+            separate();
+            out << R"({"name":)";
+            writeJsonString(out, demangle(event.name));
+            out << R"(,"cat":)";
+            writeJsonString(out, event.category);
+            out << R"(,"ph":"X","pid":1,"tid":)" << event.track
+                << R"(,"ts":)" << begin.count() << R"(,"dur":)"
+                << duration.count() << '}';
+        }
+    }
+
+    out << "],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+} // namespace blpl
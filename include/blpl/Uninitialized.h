@@ -0,0 +1,64 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace blpl {
+
+/**
+ * @brief Raw, suitably aligned storage for exactly one object of type T whose
+ * lifetime is managed explicitly by the owner.
+ *
+ * This allows to store payloads that are not default-constructible without
+ * wrapping them into std::optional or a heap allocation. The owner has to keep
+ * track of whether an object currently lives in the storage, construct() and
+ * destroy() have to be called alternately.
+ */
+template <class T>
+class Uninitialized
+{
+public:
+    Uninitialized() noexcept = default;
+
+    Uninitialized(const Uninitialized&) = delete;
+    Uninitialized& operator=(const Uninitialized&) = delete;
+
+    template <class... Args>
+    T& construct(Args&&... args) noexcept(
+        std::is_nothrow_constructible<T, Args&&...>::value)
+    {
+        return *::new (static_cast<void*>(&m_storage))
+            T(std::forward<Args>(args)...);
+    }
+
+    void destroy() noexcept
+    {
+        get().~T();
+    }
+
+    T& get() noexcept
+    {
+        return *std::launder(reinterpret_cast<T*>(&m_storage));
+    }
+    const T& get() const noexcept
+    {
+        return *std::launder(reinterpret_cast<const T*>(&m_storage));
+    }
+
+    /**
+     * @brief Moves the object out of the storage and destroys the moved-from
+     * remains.
+     */
+    T take() noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        T temp = std::move(get());
+        destroy();
+        return temp;
+    }
+
+private:
+    std::aligned_storage_t<sizeof(T), alignof(T)> m_storage;
+};
+
+} // namespace blpl
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AbstractFilter.h"
+
+namespace blpl {
+
+/**
+ * @brief State of one pipe of a pipeline when a stall was detected.
+ */
+struct PipeState
+{
+    /// number of elements, including a pending reset marker
+    unsigned int size = 0;
+    bool enabled      = false;
+    bool waiting      = false;
+    /// payload bytes, if the pipeline has a memory budget
+    size_t bytes = 0;
+};
+
+/**
+ * @brief Describes a filter that has been processing the same element for
+ * longer than the threshold of the watchdog, see
+ * AbstractPipeline::startWatchdog().
+ */
+struct StallReport
+{
+    size_t stage = 0;
+    std::shared_ptr<AbstractFilter> filter;
+    /// demangled names of the filter type and its in and out data types
+    std::string filterName;
+    std::string inType;
+    std::string outType;
+    /// time since the filter started processing the element
+    std::chrono::duration<double> stalledFor{};
+    /// the in pipes of all stages followed by the out pipe of the pipeline
+    std::vector<PipeState> pipes;
+
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const StallReport& report)
+    {
+        out << "stage " << report.stage << ' ' << report.filterName
+            << " (" << report.inType << " -> " << report.outType
+            << ") stalled for " << report.stalledFor.count() << " s\n";
+        for (size_t i = 0; i < report.pipes.size(); ++i) {
+            const auto& pipe = report.pipes[i];
+            out << "  pipe " << i << ": " << pipe.size << " elements"
+                << (pipe.waiting ? ", waiting" : ", discarding")
+                << (pipe.enabled ? "" : ", disabled");
+            if (pipe.bytes > 0)
+                out << ", " << pipe.bytes << " bytes";
+            out << '\n';
+        }
+
+        return out;
+    }
+};
+
+namespace detail {
+
+/**
+ * @brief Thread that calls a check at a fixed interval until it is destroyed.
+ */
+class Watchdog
+{
+public:
+    Watchdog(std::chrono::steady_clock::duration interval,
+             std::function<void()> check)
+        : m_interval(interval)
+        , m_check(std::move(check))
+        , m_thread(&Watchdog::run, this)
+    {}
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    ~Watchdog()
+    {
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_stopped.notify_all();
+        m_thread.join();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopped.wait_for(lock, m_interval, [this] {
+            return !m_running;
+        })) {
+            lock.unlock();
+            m_check();
+            lock.lock();
+        }
+    }
+
+private:
+    const std::chrono::steady_clock::duration m_interval;
+    std::function<void()> m_check;
+
+    std::mutex m_mutex;
+    std::condition_variable m_stopped;
+    bool m_running = true;
+
+    std::thread m_thread;
+};
+
+} // namespace detail
+
+} // namespace blpl
@@ -0,0 +1,102 @@
+#include "blpl/Batch.h"
+#include "blpl/BatchFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <cstdint>
+#include <memory>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+using PointBatch = Batch<64, float, float>;
+
+TEST_CASE("batch columns are aligned and filled element wise")
+{
+    PointBatch batch;
+    REQUIRE(batch.empty());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(batch.column<0>()) %
+                PointBatch::alignment ==
+            0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(batch.column<1>()) %
+                PointBatch::alignment ==
+            0);
+
+    for (int i = 0; i < 64; ++i)
+        batch.push(static_cast<float>(i), static_cast<float>(2 * i));
+    REQUIRE(batch.full());
+    REQUIRE(batch.column<0>()[10] == 10.f);
+    REQUIRE(batch.column<1>()[10] == 20.f);
+
+    PointBatch copy = batch;
+    batch.column<0>()[10] = 0.f;
+    REQUIRE(copy.size() == 64);
+    REQUIRE(copy.column<0>()[10] == 10.f);
+
+    const float* data = batch.column<0>();
+    PointBatch moved  = std::move(batch);
+    REQUIRE(moved.column<0>() == data);
+}
+
+TEST_CASE("batch filter lifts a scalar function")
+{
+    auto length = makeBatchFilter<PointBatch>(
+        [](float x, float y) { return x * x + y * y; });
+
+    PointBatch batch;
+    batch.push(3.f, 4.f);
+    batch.push(1.f, 0.f);
+
+    Batch<64, float> out = length.process(std::move(batch));
+    REQUIRE(out.size() == 2);
+    REQUIRE(out.column<0>()[0] == 25.f);
+    REQUIRE(out.column<0>()[1] == 1.f);
+}
+
+TEST_CASE("batch filter with the same output type works in place")
+{
+    using FloatBatch = Batch<16, float>;
+    auto twice = makeBatchFilter<FloatBatch>([](float x) { return 2.f * x; });
+
+    FloatBatch batch;
+    batch.resize(16);
+    for (size_t i = 0; i < 16; ++i)
+        batch.column<0>()[i] = static_cast<float>(i);
+    const float* data = batch.column<0>();
+
+    FloatBatch out = twice.process(std::move(batch));
+    REQUIRE(out.column<0>() == data);
+    REQUIRE(out.column<0>()[15] == 30.f);
+}
+
+class PointSource : public Filter<Generator, PointBatch>
+{
+public:
+    PointBatch processImpl(Generator&&) override
+    {
+        PointBatch batch;
+        while (!batch.full())
+            batch.push(1.f, 1.f);
+        return batch;
+    }
+};
+
+TEST_CASE("batches in a pipeline")
+{
+    auto length = makeBatchFilter<PointBatch>(
+        [](float x, float y) { return x * x + y * y; });
+    auto pipeline = std::make_shared<PointSource>() | std::move(length);
+    pipeline.outPipe()->setWaitForSlowestFilter(true);
+
+    pipeline.start();
+    auto out = pipeline.outPipe()->blockingPop();
+    pipeline.stop();
+
+    REQUIRE(out.size() == 64);
+    REQUIRE(out.column<0>()[63] == 2.f);
+}
+
+} // namespace
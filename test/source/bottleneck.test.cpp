@@ -0,0 +1,90 @@
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class FastSource : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        return m_i++;
+    }
+
+    int m_i = 0;
+};
+
+class SlowFilter : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return in;
+    }
+};
+
+class FastSink : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        return in;
+    }
+};
+
+TEST_CASE("bottleneck report names the slowest stage")
+{
+    auto pipeline = std::make_shared<FastSource>() |
+                    std::make_shared<SlowFilter>() |
+                    std::make_shared<FastSink>();
+
+    REQUIRE(pipeline.bottleneckReport().limitingStage() == 3);
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    pipeline.stop();
+
+    auto report = pipeline.bottleneckReport();
+    REQUIRE(report.stages().size() == 3);
+    CHECK(report.limitingStage() == 1);
+    CHECK(report.elapsed() >= std::chrono::milliseconds(100));
+
+    const auto& source = report.stages()[0];
+    const auto& slow   = report.stages()[1];
+    const auto& sink   = report.stages()[2];
+    CHECK(slow.filter == *std::next(pipeline.filters().begin()));
+    CHECK(slow.metrics.counter > 10);
+    CHECK(slow.utilization > 0.5);
+    CHECK(source.blocking > 0.5);
+    CHECK(sink.starvation > 0.5);
+    CHECK(source.capacity > slow.capacity);
+    CHECK(report.throughput() == slow.capacity);
+    CHECK(report.estimatedGain(2.) > 1.5);
+    CHECK(report.estimatedGain(2.) <= 2.);
+
+    std::ostringstream out;
+    out << report;
+    CHECK(out.str().find("* 1 (anonymous namespace)::SlowFilter") !=
+          std::string::npos);
+
+    // the format of the stream is left as it was
+    out.precision(4);
+    out << report;
+    CHECK(out.precision() == 4);
+    CHECK((out.flags() & std::ios::floatfield) == std::ios::fmtflags());
+
+    pipeline.resetMetrics();
+    CHECK(pipeline.elapsed().count() == 0.);
+    CHECK(pipeline.metrics()[1].counter == 0);
+}
+
+} // namespace
@@ -0,0 +1,180 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+std::string tempFile(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("blpl_" + name))
+        .string();
+}
+
+/// counts the elements it has seen and sums them up
+class CountingFilter : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        ++m_count;
+        m_sum += in;
+        return in;
+    }
+
+    void reset() override
+    {
+        m_count = 0;
+        m_sum   = 0;
+    }
+
+    bool snapshot(std::string& out) const override
+    {
+        out.append(reinterpret_cast<const char*>(&m_count), sizeof(m_count));
+        out.append(reinterpret_cast<const char*>(&m_sum), sizeof(m_sum));
+        return true;
+    }
+
+    bool restore(std::string_view state) override
+    {
+        if (state.size() != sizeof(m_count) + sizeof(m_sum))
+            return false;
+
+        std::memcpy(&m_count, state.data(), sizeof(m_count));
+        std::memcpy(&m_sum, state.data() + sizeof(m_count), sizeof(m_sum));
+        return true;
+    }
+
+    int64_t m_count = 0;
+    int64_t m_sum   = 0;
+};
+
+std::shared_ptr<FunctorFilter<int, int>> makeIdentity()
+{
+    return std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return in; });
+}
+
+TEST_CASE("checkpoint and restore a stopped pipeline")
+{
+    auto path   = tempFile("checkpoint_stopped.bin");
+    auto first  = std::make_shared<CountingFilter>();
+    auto second = std::make_shared<CountingFilter>();
+    for (int i = 1; i <= 10; ++i)
+        second->process(first->process(int(i)));
+
+    auto pipeline = first | makeIdentity() | second;
+    REQUIRE(pipeline.checkpoint(path));
+
+    // a fresh pipeline after a restart picks up where the other left off
+    auto restoredFirst  = std::make_shared<CountingFilter>();
+    auto restoredSecond = std::make_shared<CountingFilter>();
+    auto restored       = restoredFirst | makeIdentity() | restoredSecond;
+    REQUIRE(restored.restore(path));
+    REQUIRE(restoredFirst->m_count == 10);
+    REQUIRE(restoredFirst->m_sum == 55);
+    REQUIRE(restoredSecond->m_count == 10);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("checkpoint a running pipeline at an element boundary")
+{
+    auto path     = tempFile("checkpoint_running.bin");
+    auto first    = std::make_shared<CountingFilter>();
+    auto second   = std::make_shared<CountingFilter>();
+    auto pipeline = first | makeIdentity() | second;
+    pipeline.setPipeCapacity(0, 16);
+    pipeline.start();
+
+    std::atomic<bool> done(false);
+    std::thread producer([&] {
+        for (int i = 1; !done; ++i)
+            pipeline.pushFor(int(i), std::chrono::milliseconds(10));
+    });
+
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(pipeline.checkpoint(path));
+
+        // both stages saw the same elements
+        auto restoredFirst  = std::make_shared<CountingFilter>();
+        auto restoredSecond = std::make_shared<CountingFilter>();
+        auto restored       = restoredFirst | makeIdentity() | restoredSecond;
+        REQUIRE(restored.restore(path));
+        REQUIRE(restoredFirst->m_count == restoredSecond->m_count);
+        REQUIRE(restoredFirst->m_sum == restoredSecond->m_sum);
+    }
+
+    done = true;
+    producer.join();
+    pipeline.stop();
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("a throwing snapshot resumes the pipeline")
+{
+    class BrokenFilter : public CountingFilter
+    {
+    public:
+        bool snapshot(std::string&) const override
+        {
+            throw std::runtime_error("no snapshot");
+        }
+    };
+
+    auto path     = tempFile("checkpoint_broken.bin");
+    auto pipeline = std::make_shared<CountingFilter>() |
+                    std::make_shared<BrokenFilter>() | makeIdentity();
+    pipeline.start();
+    REQUIRE(pipeline.pushFor(1, std::chrono::seconds(1)));
+    REQUIRE(pipeline.outPipe()->blockingPop() == 1);
+
+    REQUIRE_THROWS_AS(pipeline.checkpoint(path), std::runtime_error);
+    REQUIRE_FALSE(std::filesystem::exists(path));
+
+    // all stages take elements again
+    REQUIRE(pipeline.pushFor(2, std::chrono::seconds(1)));
+    REQUIRE(pipeline.outPipe()->blockingPop() == 2);
+    pipeline.stop();
+}
+
+TEST_CASE("restore refuses foreign checkpoints")
+{
+    auto path     = tempFile("checkpoint_foreign.bin");
+    auto pipeline = std::make_shared<CountingFilter>() | makeIdentity();
+    REQUIRE_FALSE(pipeline.restore(tempFile("checkpoint_missing.bin")));
+    REQUIRE(pipeline.checkpoint(path));
+
+    // the filters have different types
+    auto other = makeIdentity() | std::make_shared<CountingFilter>();
+    REQUIRE_FALSE(other.restore(path));
+
+    // and different lengths
+    auto longer =
+        std::make_shared<CountingFilter>() | makeIdentity() | makeIdentity();
+    REQUIRE_FALSE(longer.restore(path));
+
+    pipeline.start();
+    REQUIRE_FALSE(pipeline.restore(path));
+    pipeline.stop();
+    REQUIRE(pipeline.restore(path));
+
+    std::filesystem::remove(path);
+}
+
+} // namespace
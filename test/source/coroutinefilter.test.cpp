@@ -0,0 +1,261 @@
+// coroutine filters need C++20, see the blplCoroutineTests target
+#if defined(__cpp_impl_coroutine) && defined(__linux__)
+
+#include <blpl/CoroutineFilter.h>
+#include <blpl/Pipeline.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <doctest/doctest.h>
+
+namespace {
+
+struct Stamped
+{
+    int id;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+} // namespace
+
+template <>
+struct blpl::DeadlineOf<Stamped>
+{
+    static std::optional<std::chrono::steady_clock::time_point>
+    of(const Stamped& stamped) noexcept
+    {
+        return stamped.deadline;
+    }
+};
+
+using namespace blpl;
+
+namespace {
+
+/**
+ * Sends its input through a socket pair and waits for it to arrive on the
+ * other end before returning it incremented by one.
+ */
+class SocketFilter : public CoroutineFilter<int, int>
+{
+public:
+    explicit SocketFilter(std::shared_ptr<IoExecutor> executor =
+                              IoExecutor::defaultExecutor())
+        : CoroutineFilter<int, int>(std::move(executor))
+    {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds);
+    }
+    ~SocketFilter() override
+    {
+        close(m_fds[0]);
+        close(m_fds[1]);
+    }
+
+protected:
+    Task<int> processAsyncImpl(int&& in) override
+    {
+        co_await writable(m_fds[0]);
+        REQUIRE(write(m_fds[0], &in, sizeof(in)) == sizeof(in));
+
+        co_await readable(m_fds[1]);
+        int received = 0;
+        REQUIRE(read(m_fds[1], &received, sizeof(received)) ==
+                sizeof(received));
+
+        co_return received + 1;
+    }
+
+private:
+    int m_fds[2];
+};
+
+/**
+ * Reads as many bytes from a regular file as its input says.
+ */
+class FileFilter : public CoroutineFilter<int, int>
+{
+public:
+    FileFilter()
+        : m_file(std::tmpfile())
+    {
+        std::fputs("0123456789", m_file);
+        std::fflush(m_file);
+    }
+    ~FileFilter() override
+    {
+        std::fclose(m_file);
+    }
+
+protected:
+    Task<int> processAsyncImpl(int&& in) override
+    {
+        int fd = fileno(m_file);
+        co_await readable(fd);
+        char buffer[16];
+        co_return static_cast<int>(pread(fd, buffer, in, 0));
+    }
+
+private:
+    std::FILE* m_file;
+};
+
+class StampedFilter : public CoroutineFilter<Stamped, int>
+{
+protected:
+    Task<int> processAsyncImpl(Stamped&& in) override
+    {
+        co_await ScheduleAwaiter(executor());
+        co_return in.id;
+    }
+};
+
+class ThrowingFilter : public CoroutineFilter<int, int>
+{
+protected:
+    Task<int> processAsyncImpl(int&&) override
+    {
+        co_await ScheduleAwaiter(executor());
+        throw std::runtime_error("failed");
+    }
+};
+
+TEST_CASE("coroutine filter process")
+{
+    SocketFilter filter;
+    REQUIRE(filter.process(1) == 2);
+    REQUIRE(filter.process(41) == 42);
+}
+
+TEST_CASE("coroutine filter reading a regular file")
+{
+    FileFilter filter;
+    REQUIRE(filter.process(4) == 4);
+
+    auto pipeline = std::make_shared<FileFilter>() |
+                    std::make_shared<SocketFilter>();
+    pipeline.start();
+    int pipeData = 8;
+    pipeline.inPipe()->push(std::move(pipeData));
+    REQUIRE(pipeline.outPipe()->blockingPop() == 9);
+    pipeline.stop();
+}
+
+TEST_CASE("coroutine filter exception")
+{
+    ThrowingFilter filter;
+    REQUIRE_THROWS(filter.process(1));
+}
+
+TEST_CASE("coroutine filter in pipeline")
+{
+    static_assert(
+        std::is_same<FilterThreadType<SocketFilter>::type,
+                     CoroutineFilterThread<int, int>>::value,
+        "coroutine filters have to be driven by a CoroutineFilterThread");
+
+    auto pipeline = std::make_shared<SocketFilter>() |
+                    std::make_shared<SocketFilter>() |
+                    std::make_shared<SocketFilter>();
+    pipeline.outPipe()->setWaitForSlowestFilter(true);
+
+    pipeline.start();
+    for (int i = 0; i < 50; ++i) {
+        int pipeData = i;
+        pipeline.inPipe()->push(std::move(pipeData));
+        REQUIRE(pipeline.outPipe()->blockingPop() == i + 3);
+    }
+    pipeline.stop();
+
+    // the last element may be counted only after its result was popped
+    for (const auto& metrics : pipeline.metrics()) {
+        CHECK(metrics.counter >= 49);
+        CHECK(metrics.wallTime.count() > 0.);
+    }
+    CHECK(pipeline.bottleneckReport().stages()[0].utilization > 0.);
+}
+
+TEST_CASE("coroutine filter exception in pipeline")
+{
+    auto pipeline = std::make_shared<SocketFilter>() |
+                    std::make_shared<ThrowingFilter>();
+    pipeline.inPipe()->setWaitForSlowestFilter(true);
+    std::atomic<int> errors{0};
+    pipeline.setErrorSink([&errors](const FilterError& error) {
+        if (error.stage == 1 && error.what() == "failed")
+            ++errors;
+    });
+
+    pipeline.start();
+    for (int i = 0; i < 3; ++i) {
+        int pipeData = i;
+        pipeline.inPipe()->push(std::move(pipeData));
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pipeline.metrics()[1].errors < 3 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    pipeline.stop();
+
+    // the elements are dropped, the stage keeps running
+    REQUIRE(pipeline.metrics()[1].errors == 3);
+    REQUIRE(errors == 3);
+    REQUIRE_FALSE(pipeline.outPipe()->tryPop());
+}
+
+TEST_CASE("coroutine filter skips expired elements")
+{
+    auto pipeline = std::make_shared<StampedFilter>() |
+                    std::make_shared<SocketFilter>();
+    pipeline.setPipeCapacity(0, 16);
+    pipeline.setPipeCapacity(pipeline.length(), 16);
+
+    auto now = std::chrono::steady_clock::now();
+    // ends with a live element, so all expired ones are counted once it's out
+    for (int i = 0; i < 7; ++i) {
+        auto deadline = i % 2 ? now - std::chrono::seconds(1)
+                              : now + std::chrono::seconds(10);
+        REQUIRE(pipeline.tryPush(Stamped{i, deadline}));
+    }
+    pipeline.start();
+    for (int i = 0; i < 7; i += 2)
+        REQUIRE(pipeline.outPipe()->blockingPop() == i + 1);
+    pipeline.stop();
+
+    REQUIRE(pipeline.metrics()[0].expired == 3);
+}
+
+TEST_CASE("many coroutine filters on one thread")
+{
+    auto executor = std::make_shared<IoExecutor>(1);
+
+    auto pipeline = std::make_shared<SocketFilter>(executor) |
+                    std::make_shared<SocketFilter>(executor);
+    for (int i = 0; i < 14; ++i)
+        pipeline = std::move(pipeline) | std::make_shared<SocketFilter>(executor);
+    REQUIRE(pipeline.length() == 16);
+    pipeline.inPipe()->setWaitForSlowestFilter(true);
+    pipeline.outPipe()->setWaitForSlowestFilter(true);
+
+    pipeline.start();
+    std::thread producer([&pipeline] {
+        for (int i = 0; i < 20; ++i) {
+            int pipeData = i;
+            pipeline.inPipe()->push(std::move(pipeData));
+        }
+    });
+    for (int i = 0; i < 20; ++i)
+        REQUIRE(pipeline.outPipe()->blockingPop() == i + 16);
+    producer.join();
+    pipeline.stop();
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,146 @@
+#include "blpl/Deadline.h"
+#include "blpl/FunctorFilter.h"
+#include "blpl/LaneMultiFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Frame
+{
+    int id;
+    Clock::time_point deadline;
+};
+
+} // namespace
+
+template <>
+struct blpl::DeadlineOf<Frame>
+{
+    static std::optional<Clock::time_point> of(const Frame& frame) noexcept
+    {
+        return frame.deadline;
+    }
+};
+
+/// a vector of frames is due with its first frame
+template <>
+struct blpl::DeadlineOf<std::vector<Frame>>
+{
+    static std::optional<Clock::time_point>
+    of(const std::vector<Frame>& frames) noexcept
+    {
+        if (frames.empty())
+            return std::nullopt;
+        return frames.front().deadline;
+    }
+};
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+TEST_CASE("expired elements")
+{
+    auto now = Clock::now();
+    REQUIRE(isExpired(Frame{0, now - std::chrono::seconds(1)}));
+    REQUIRE_FALSE(isExpired(Frame{0, now + std::chrono::seconds(10)}));
+
+    // payloads without a deadline never expire
+    REQUIRE_FALSE(isExpired(42));
+}
+
+TEST_CASE("filter threads skip expired elements")
+{
+    std::mutex mutex;
+    std::vector<int> processed;
+    auto record = std::make_shared<FunctorFilter<Frame, Frame>>(
+        [&](Frame&& in) {
+            std::scoped_lock<std::mutex> lock(mutex);
+            processed.push_back(in.id);
+            return in;
+        });
+    auto identity = std::make_shared<FunctorFilter<Frame, Frame>>(
+        [](Frame&& in) { return in; });
+
+    auto pipeline = record | identity;
+    pipeline.setPipeCapacity(0, 16);
+    pipeline.setPipeCapacity(pipeline.length(), 16);
+
+    // queue up the frames before the stages run, every other one is stale
+    auto now = Clock::now();
+    for (int i = 0; i < 10; ++i) {
+        auto deadline = i % 2 ? now - std::chrono::seconds(1)
+                              : now + std::chrono::seconds(10);
+        REQUIRE(pipeline.tryPush(Frame{i, deadline}));
+    }
+    pipeline.start();
+
+    std::vector<int> out;
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (out.size() < 5 && Clock::now() < deadline) {
+        if (auto frame = pipeline.outPipe()->tryPop())
+            out.push_back(frame->id);
+        else
+            std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    REQUIRE((out == std::vector<int>{0, 2, 4, 6, 8}));
+    REQUIRE((processed == std::vector<int>{0, 2, 4, 6, 8}));
+    auto metrics = pipeline.metrics();
+    REQUIRE(metrics[0].counter == 5);
+    REQUIRE(metrics[0].expired == 5);
+    REQUIRE(metrics[1].expired == 0);
+}
+
+TEST_CASE("lane multifilters skip expired vectors")
+{
+    // every other vector is stale by the time it reaches the lanes
+    auto now    = Clock::now();
+    auto frames = std::make_shared<FunctorFilter<int, std::vector<Frame>>>(
+        [now](int&& id) {
+            auto deadline = id % 2 ? now - std::chrono::seconds(1)
+                                   : now + std::chrono::seconds(10);
+            return std::vector<Frame>{{id, deadline}, {id, deadline}};
+        });
+    auto lane = std::make_shared<FunctorFilter<Frame, Frame>>(
+        [](Frame&& in) { return in; });
+
+    auto pipeline = frames | LaneMultiFilter<Frame, Frame>(lane & lane);
+    pipeline.setPipeCapacity(0, 16);
+    pipeline.setPipeCapacity(1, 16);
+    pipeline.setPipeCapacity(pipeline.length(), 16);
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(pipeline.tryPush(int(i)));
+    pipeline.start();
+
+    std::vector<int> out;
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (out.size() < 5 && Clock::now() < deadline) {
+        if (auto joined = pipeline.outPipe()->tryPop())
+            out.push_back(joined->front().id);
+        else
+            std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    REQUIRE((out == std::vector<int>{0, 2, 4, 6, 8}));
+    auto metrics = pipeline.metrics();
+    REQUIRE(metrics[0].expired == 0);
+    REQUIRE(metrics[1].expired == 5);
+}
+
+} // namespace
@@ -0,0 +1,232 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/LaneMultiFilter.h"
+#include "blpl/MpmcQueue.h"
+#include "blpl/Pipe.h"
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// payload whose move constructor throws on request
+struct Fragile
+{
+    explicit Fragile(int value, bool breaks = false)
+        : value(value)
+        , breaks(breaks)
+    {}
+    Fragile(Fragile&& other)
+        : value(other.value)
+        , breaks(other.breaks)
+    {
+        if (breaks)
+            throw std::runtime_error("broken move");
+    }
+    Fragile& operator=(Fragile&&) = default;
+
+    int value;
+    bool breaks;
+};
+
+template <class InData, class OutData>
+std::vector<OutData> popAll(Pipeline<InData, OutData>& pipeline, size_t count)
+{
+    std::vector<OutData> out;
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (out.size() < count && Clock::now() < deadline) {
+        if (auto elem = pipeline.outPipe()->tryPop())
+            out.push_back(*elem);
+        else
+            std::this_thread::yield();
+    }
+
+    return out;
+}
+
+TEST_CASE("a throwing filter drops the element and keeps running")
+{
+    auto identity = std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return in; });
+    auto picky = std::make_shared<FunctorFilter<int, int>>([](int&& in) {
+        if (in % 3 == 0)
+            throw std::invalid_argument("multiple of 3: "
+                                        + std::to_string(in));
+        return in;
+    });
+
+    auto pipeline = identity | picky;
+    pipeline.setPipeCapacity(0, 16);
+    pipeline.setPipeCapacity(pipeline.length(), 16);
+
+    std::mutex mutex;
+    std::vector<FilterError> errors;
+    pipeline.setErrorSink([&](const FilterError& error) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        errors.push_back(error);
+    });
+
+    for (int i = 1; i <= 9; ++i)
+        REQUIRE(pipeline.tryPush(int(i)));
+    pipeline.start();
+    auto out = popAll(pipeline, 6);
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (pipeline.metrics()[1].errors < 3 && Clock::now() < deadline)
+        std::this_thread::yield();
+    pipeline.stop();
+
+    REQUIRE((out == std::vector<int>{1, 2, 4, 5, 7, 8}));
+    REQUIRE(errors.size() == 3);
+    for (size_t i = 0; i < errors.size(); ++i) {
+        REQUIRE(errors[i].stage == 1);
+        REQUIRE(errors[i].sequence == 3 * i + 2);
+        REQUIRE(errors[i].filter == picky);
+        REQUIRE(errors[i].what()
+                == "multiple of 3: " + std::to_string(3 * i + 3));
+    }
+
+    auto metrics = pipeline.metrics();
+    REQUIRE(metrics[0].errors == 0);
+    REQUIRE(metrics[1].errors == 3);
+    REQUIRE(metrics[1].counter == 6);
+}
+
+TEST_CASE("errors in a dead-letter pipe")
+{
+    auto identity = std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return in; });
+    auto failing = std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) -> int { throw in; });
+    auto pipeline    = identity | failing;
+    auto deadLetters = pipeline.makeDeadLetterPipe(4);
+
+    pipeline.start();
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(pipeline.pushFor(int(i), std::chrono::seconds(1)));
+
+    // the pipe keeps the latest errors
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (pipeline.metrics()[1].errors < 10 && Clock::now() < deadline)
+        std::this_thread::yield();
+    pipeline.stop();
+
+    REQUIRE(pipeline.metrics()[1].errors == 10);
+    std::vector<uint64_t> sequences;
+    while (auto error = deadLetters->tryPop()) {
+        REQUIRE(error->stage == 1);
+        REQUIRE(error->what().empty());
+        sequences.push_back(error->sequence);
+    }
+    REQUIRE(sequences.size() == 4);
+    REQUIRE(sequences.back() == 9);
+}
+
+std::shared_ptr<FunctorFilter<int, int>> makeFailingOn(int value)
+{
+    return std::make_shared<FunctorFilter<int, int>>([value](int&& in) {
+        if (in == value)
+            throw std::invalid_argument(std::to_string(in));
+        return in;
+    });
+}
+
+template <class Stage>
+void checkMultiFilterStage(Stage&& stage)
+{
+    using Vector  = std::vector<int>;
+    auto identity = std::make_shared<FunctorFilter<Vector, Vector>>(
+        [](Vector&& in) { return in; });
+    auto pipeline = identity | std::forward<Stage>(stage);
+    pipeline.setPipeCapacity(0, 4);
+    pipeline.setPipeCapacity(pipeline.length(), 4);
+
+    std::mutex mutex;
+    std::vector<FilterError> errors;
+    pipeline.setErrorSink([&](const FilterError& error) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        errors.push_back(error);
+    });
+
+    pipeline.start();
+    REQUIRE(pipeline.pushFor(Vector{1, 2}, std::chrono::seconds(1)));
+    REQUIRE(pipeline.pushFor(Vector{1, 7}, std::chrono::seconds(1)));
+    REQUIRE(pipeline.pushFor(Vector{3, 4}, std::chrono::seconds(1)));
+    auto out      = popAll(pipeline, 2);
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (pipeline.metrics()[1].errors < 1 && Clock::now() < deadline)
+        std::this_thread::yield();
+    pipeline.stop();
+
+    // the vector with the failing element is dropped as a whole
+    REQUIRE((out == std::vector<Vector>{{1, 2}, {3, 4}}));
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors[0].stage == 1);
+    REQUIRE(errors[0].sequence == 1);
+    REQUIRE(errors[0].what() == "7");
+}
+
+TEST_CASE("a throwing sub-filter drops the vector of a multifilter")
+{
+    SUBCASE("lockstep")
+    {
+        checkMultiFilterStage(makeFailingOn(7) & makeFailingOn(7));
+    }
+    SUBCASE("independent lanes")
+    {
+        checkMultiFilterStage(LaneMultiFilter<int, int>(makeFailingOn(7) &
+                                                        makeFailingOn(7)));
+    }
+}
+
+TEST_CASE("throwing moves leave pipes usable")
+{
+    SUBCASE("single slot")
+    {
+        Pipe<Fragile> pipe;
+        REQUIRE_THROWS(pipe.push(Fragile(1, true)));
+        REQUIRE(pipe.size() == 0);
+        pipe.push(Fragile(2));
+        REQUIRE(pipe.tryPop()->value == 2);
+    }
+    SUBCASE("queue")
+    {
+        Pipe<Fragile> pipe(true, 4);
+        pipe.push(Fragile(1));
+        REQUIRE_THROWS(pipe.push(Fragile(2, true)));
+        pipe.push(Fragile(3));
+
+        REQUIRE(pipe.tryPop()->value == 1);
+        REQUIRE(pipe.tryPop()->value == 3);
+        REQUIRE_FALSE(pipe.tryPop());
+    }
+    SUBCASE("lock-free queue")
+    {
+        MpmcQueue<Fragile> queue(2);
+        REQUIRE(queue.tryPush(Fragile(1)));
+        REQUIRE_THROWS(queue.tryPush(Fragile(2, true)));
+        REQUIRE(queue.tryPop()->value == 1);
+
+        // pops skip the cell of the lost element and free it again
+        REQUIRE(queue.tryPush(Fragile(3)));
+        REQUIRE(queue.tryPop()->value == 3);
+        REQUIRE(queue.tryPush(Fragile(4)));
+        REQUIRE(queue.tryPush(Fragile(5)));
+        REQUIRE(queue.tryPop()->value == 4);
+        REQUIRE(queue.tryPop()->value == 5);
+        REQUIRE_FALSE(queue.tryPop());
+    }
+}
+
+} // namespace
@@ -17,6 +17,16 @@ public:
     void reset() override {}
 };
 
+class HandleFilter : public Filter<std::unique_ptr<int>, std::unique_ptr<int>>
+{
+public:
+    std::unique_ptr<int> processImpl(std::unique_ptr<int>&& in) override
+    {
+        ++*in;
+        return std::move(in);
+    }
+};
+
 TEST_CASE("construction")
 {
     auto inPipe  = std::make_shared<Pipe<int>>();
@@ -91,3 +101,18 @@ TEST_CASE("metrics")
 }
 
 } // namespace
+
+TEST_CASE("move-only payload")
+{
+    auto inPipe  = std::make_shared<Pipe<std::unique_ptr<int>>>();
+    auto outPipe = std::make_shared<Pipe<std::unique_ptr<int>>>();
+    auto filter  = std::make_shared<HandleFilter>();
+    FilterThread<std::unique_ptr<int>, std::unique_ptr<int>> ft(
+        inPipe, filter, outPipe);
+
+    ft.start();
+    inPipe->push(std::make_unique<int>(1));
+    auto out = outPipe->blockingPop();
+    REQUIRE(out);
+    REQUIRE(*out == 2);
+}
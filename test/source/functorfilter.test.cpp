@@ -1,12 +1,77 @@
 #include <blpl/FunctorFilter.h>
 
+#include <vector>
+
 #include <doctest/doctest.h>
 
 using namespace blpl;
 
+namespace {
+
+struct CopyCounter
+{
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter& other)
+        : copies(other.copies + 1)
+    {}
+    CopyCounter(CopyCounter&&) = default;
+    CopyCounter& operator=(const CopyCounter& other)
+    {
+        copies = other.copies + 1;
+        return *this;
+    }
+    CopyCounter& operator=(CopyCounter&&) = default;
+
+    int copies = 0;
+};
+
 TEST_CASE("construct and run")
 {
     FunctorFilter<int, int> filter([](int&& in) -> int { return in + 1; });
 
     REQUIRE(filter.process(4) == 5);
 }
+
+TEST_CASE("std::function functor does not copy the input")
+{
+    FunctorFilter<CopyCounter, CopyCounter> filter(
+        [](CopyCounter&& in) { return std::move(in); });
+
+    REQUIRE(filter.process(CopyCounter()).copies == 0);
+}
+
+TEST_CASE("make functor filter from lambda")
+{
+    int calls   = 0;
+    auto filter = makeFunctorFilter<std::vector<int>>(
+        [&calls](std::vector<int>&& in) {
+            ++calls;
+            in.push_back(static_cast<int>(in.size()));
+            return std::move(in);
+        });
+
+    static_assert(std::is_same<decltype(filter)::outType,
+                               std::vector<int>>::value,
+                  "OutData has to be deduced from the lambda");
+
+    std::vector<int> in{0, 1};
+    in.reserve(3);
+    const int* data = in.data();
+    auto out        = filter.process(std::move(in));
+
+    REQUIRE(calls == 1);
+    REQUIRE(out.size() == 3);
+    REQUIRE(out[2] == 2);
+    // the buffer was moved through the filter
+    REQUIRE(out.data() == data);
+}
+
+TEST_CASE("make functor filter does not copy the input")
+{
+    auto filter = makeFunctorFilter<CopyCounter>(
+        [](CopyCounter&& in) { return std::move(in); });
+
+    REQUIRE(filter.process(CopyCounter()).copies == 0);
+}
+
+} // namespace
@@ -0,0 +1,110 @@
+#include "blpl/Pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+/// holds the first element until it is opened
+class GateFilter : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        m_entered = true;
+        while (!m_open)
+            std::this_thread::yield();
+        return in;
+    }
+
+    std::atomic<bool> m_entered{false};
+    std::atomic<bool> m_open{false};
+};
+
+class CountingSink : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        ++m_count;
+        return in;
+    }
+
+    bool waitFor(int count)
+    {
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (m_count < count && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return m_count == count;
+    }
+
+    std::atomic<int> m_count{0};
+};
+
+TEST_CASE("ingress rejects elements while the in pipe is full")
+{
+    auto gate     = std::make_shared<GateFilter>();
+    auto sink     = std::make_shared<CountingSink>();
+    auto pipeline = gate | sink;
+    REQUIRE(pipeline.setPipeCapacity(0, 4));
+    pipeline.start();
+
+    REQUIRE(pipeline.tryPush(0));
+    while (!gate->m_entered)
+        std::this_thread::yield();
+
+    for (int i = 1; i <= 4; ++i)
+        REQUIRE(pipeline.tryPush(int(i)));
+    REQUIRE_FALSE(pipeline.tryPush(5));
+    REQUIRE_FALSE(pipeline.pushFor(5, std::chrono::milliseconds(10)));
+
+    std::vector<int> batch{6, 7, 8};
+    REQUIRE(pipeline.pushBatch(batch) == 0);
+    REQUIRE(batch.size() == 3);
+
+    auto stats = pipeline.ingressStats();
+    REQUIRE(stats.depth == 4);
+    REQUIRE(stats.capacity == 4);
+    REQUIRE(stats.rejected == 5);
+
+    gate->m_open = true;
+    REQUIRE(pipeline.pushFor(5, std::chrono::seconds(1)));
+    REQUIRE(sink->waitFor(6));
+
+    REQUIRE(pipeline.pushBatch(batch) == 3);
+    REQUIRE(batch.empty());
+    REQUIRE(sink->waitFor(9));
+    REQUIRE(pipeline.ingressStats().rejected == 5);
+
+    pipeline.stop();
+}
+
+TEST_CASE("ingress into a single slot in pipe")
+{
+    auto gate     = std::make_shared<GateFilter>();
+    auto sink     = std::make_shared<CountingSink>();
+    auto pipeline = gate | sink;
+
+    REQUIRE(pipeline.tryPush(0));
+    while (!gate->m_entered)
+        std::this_thread::yield();
+
+    REQUIRE(pipeline.tryPush(1));
+    REQUIRE_FALSE(pipeline.tryPush(2));
+    REQUIRE(pipeline.ingressStats().capacity == 1);
+
+    gate->m_open = true;
+    REQUIRE(sink->waitFor(2));
+    pipeline.stop();
+}
+
+} // namespace
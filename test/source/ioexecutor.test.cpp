@@ -0,0 +1,122 @@
+#if defined(__linux__)
+
+#include <blpl/IoExecutor.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+namespace {
+
+TEST_CASE("post")
+{
+    IoExecutor executor(2);
+    REQUIRE(executor.numThreads() == 2);
+
+    std::promise<std::thread::id> promise;
+    executor.post(
+        [&promise] { promise.set_value(std::this_thread::get_id()); });
+
+    auto future = promise.get_future();
+    REQUIRE(future.wait_for(std::chrono::seconds(1)) ==
+            std::future_status::ready);
+    REQUIRE(future.get() != std::this_thread::get_id());
+}
+
+TEST_CASE("when readable")
+{
+    IoExecutor executor;
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    std::atomic<bool> called(false);
+    executor.whenReadable(fds[0], [&called] { called = true; });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE_FALSE(called);
+
+    char data = 'x';
+    REQUIRE(write(fds[1], &data, 1) == 1);
+    for (int i = 0; i < 100 && !called; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(called);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("when readable and writable")
+{
+    IoExecutor executor;
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    std::atomic<int> readable(0);
+    std::atomic<int> writable(0);
+    executor.whenReadable(fds[0], [&readable] { ++readable; });
+    executor.whenWritable(fds[1], [&writable] { ++writable; });
+
+    // the write end of an empty pipe is writable right away
+    for (int i = 0; i < 100 && writable == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(writable == 1);
+    REQUIRE(readable == 0);
+
+    char data = 'x';
+    REQUIRE(write(fds[1], &data, 1) == 1);
+    for (int i = 0; i < 100 && readable == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(readable == 1);
+
+    // callbacks are only called once
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(readable == 1);
+    REQUIRE(writable == 1);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("regular files are always ready")
+{
+    IoExecutor executor;
+    FILE* file = std::tmpfile();
+    REQUIRE(file);
+    int fd = fileno(file);
+
+    std::atomic<int> readable(0);
+    std::atomic<int> writable(0);
+    executor.whenReadable(fd, [&readable] { ++readable; });
+    executor.whenWritable(fd, [&writable] { ++writable; });
+    for (int i = 0; i < 100 && (readable == 0 || writable == 0); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(readable == 1);
+    REQUIRE(writable == 1);
+
+    std::fclose(file);
+}
+
+TEST_CASE("invalid file descriptors are reported")
+{
+    IoExecutor executor;
+    REQUIRE_THROWS_AS(executor.whenReadable(-1, [] {}), std::system_error);
+
+    // the executor keeps working
+    std::promise<void> promise;
+    executor.post([&promise] { promise.set_value(); });
+    REQUIRE(promise.get_future().wait_for(std::chrono::seconds(1)) ==
+            std::future_status::ready);
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,114 @@
+#include "blpl/LaneMultiFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class SequenceSource : public Filter<Generator, std::vector<int>>
+{
+public:
+    std::vector<int> processImpl(Generator&&) override
+    {
+        ++m_i;
+        return {m_i, m_i};
+    }
+
+    int m_i = 0;
+};
+
+/// sleeps on every other element, with an offset per lane
+class UnevenLane : public Filter<int, int>
+{
+public:
+    explicit UnevenLane(int offset)
+        : m_offset(offset)
+    {}
+
+    int processImpl(int&& in) override
+    {
+        if ((in + m_offset) % 2 == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        return in * 10 + m_offset;
+    }
+
+private:
+    int m_offset;
+};
+
+class CollectingSink : public Filter<std::vector<int>, int>
+{
+public:
+    int processImpl(std::vector<int>&& in) override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_received.push_back(std::move(in));
+        return 0;
+    }
+
+    std::vector<std::vector<int>> received()
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_received;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::vector<int>> m_received;
+};
+
+TEST_CASE("lane multifilter processes directly in lockstep")
+{
+    LaneMultiFilter<int, int> lanes(std::make_shared<UnevenLane>(0) &
+                                        std::make_shared<UnevenLane>(1),
+                                    2);
+    REQUIRE(lanes.maxSkew() == 2);
+    REQUIRE(lanes.numParallel() == 2);
+
+    auto out = lanes.process({3, 4});
+    REQUIRE((out == std::vector<int>{30, 41}));
+}
+
+TEST_CASE("lane multifilter in a pipeline keeps the order of the results")
+{
+    auto sink     = std::make_shared<CollectingSink>();
+    auto pipeline = std::make_shared<SequenceSource>() |
+                    LaneMultiFilter<int, int>(std::make_shared<UnevenLane>(0) &
+                                                  std::make_shared<UnevenLane>(1),
+                                              4) |
+                    sink;
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pipeline.stop();
+
+    auto received = sink->received();
+    REQUIRE(received.size() > 5);
+    for (size_t i = 0; i < received.size(); ++i) {
+        REQUIRE(received[i].size() == 2);
+        // waiting pipes don't drop anything
+        CHECK(received[i][0] == static_cast<int>(i + 1) * 10);
+        CHECK(received[i][1] == static_cast<int>(i + 1) * 10 + 1);
+    }
+
+    auto metrics = pipeline.metrics();
+    CHECK(metrics[1].counter >= received.size());
+    CHECK(metrics[1].wallTime.count() > 0.);
+
+    // restart after stop
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pipeline.stop();
+    CHECK(sink->received().size() > received.size());
+}
+
+} // namespace
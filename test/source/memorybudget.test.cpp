@@ -0,0 +1,141 @@
+#include "blpl/MemoryBudget.h"
+#include "blpl/Pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+using Payload = std::vector<int>;
+
+size_t payloadBytes(const Payload& payload)
+{
+    return PayloadSize<Payload>::of(payload);
+}
+
+TEST_CASE("payload sizes")
+{
+    REQUIRE(PayloadSize<int>::of(1) == sizeof(int));
+
+    std::string string(100, 'x');
+    REQUIRE(PayloadSize<std::string>::of(string) >= sizeof(string) + 100);
+
+    std::vector<Payload> nested(2, Payload(10));
+    nested.shrink_to_fit();
+    size_t expected = sizeof(nested) + 2 * payloadBytes(nested[0]);
+    REQUIRE(PayloadSize<std::vector<Payload>>::of(nested) == expected);
+}
+
+TEST_CASE("pipes account their payload bytes")
+{
+    auto budget = std::make_shared<MemoryBudget>();
+    Pipe<Payload> pipe;
+    REQUIRE(pipe.setMemoryBudget(budget, false));
+
+    Payload small(10);
+    Payload large(1000);
+    size_t smallBytes = payloadBytes(small);
+    size_t largeBytes = payloadBytes(large);
+
+    pipe.push(std::move(small));
+    REQUIRE(pipe.bytes() == smallBytes);
+
+    // the discarded element is no longer accounted
+    pipe.push(std::move(large));
+    REQUIRE(pipe.bytes() == largeBytes);
+    REQUIRE(budget->bytes() == largeBytes);
+
+    REQUIRE(pipe.pop().size() == 1000);
+    REQUIRE(pipe.bytes() == 0);
+    REQUIRE(budget->bytes() == 0);
+}
+
+TEST_CASE("the entry of a pipeline drops elements over budget")
+{
+    size_t bytes = payloadBytes(Payload(100));
+    auto budget =
+        std::make_shared<MemoryBudget>(2 * bytes, BudgetPolicy::Drop);
+    Pipe<Payload> pipe(true, 8);
+    REQUIRE(pipe.setMemoryBudget(budget, true));
+
+    for (int i = 0; i < 3; ++i)
+        pipe.push(Payload(100));
+    REQUIRE(pipe.size() == 2);
+    REQUIRE(budget->dropped() == 1);
+    REQUIRE_FALSE(pipe.tryPush(Payload(100)));
+
+    REQUIRE(pipe.tryPop());
+    REQUIRE(pipe.tryPush(Payload(100)));
+    REQUIRE(budget->bytes() == 2 * bytes);
+}
+
+class GateFilter : public Filter<Payload, int>
+{
+public:
+    int processImpl(Payload&& in) override
+    {
+        while (!m_open)
+            std::this_thread::yield();
+        return std::accumulate(in.begin(), in.end(), 0);
+    }
+
+    std::atomic<bool> m_open{false};
+};
+
+class IntFilter : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        return in;
+    }
+};
+
+TEST_CASE("producers block while the pipeline is over budget")
+{
+    auto gate     = std::make_shared<GateFilter>();
+    auto pipeline = gate | std::make_shared<IntFilter>();
+    size_t bytes  = payloadBytes(Payload(100, 1));
+    pipeline.setPipeCapacity(0, 8);
+    pipeline.setMemoryBudget(2 * bytes);
+    pipeline.start();
+
+    // the gate holds the first one, the next two fill the budget
+    for (int i = 0; i < 3; ++i)
+        pipeline.inPipe()->push(Payload(100, 1));
+
+    std::atomic<bool> pushed(false);
+    std::thread producer([&] {
+        pipeline.inPipe()->push(Payload(100, 1));
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE_FALSE(pushed);
+    REQUIRE(pipeline.memoryBudget()->bytes() == 2 * bytes);
+    REQUIRE(pipeline.pipeBytes().front() == 2 * bytes);
+
+    gate->m_open = true;
+    producer.join();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pipeline.inPipe()->size() > 0 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pipeline.stop();
+
+    REQUIRE(pipeline.pipeBytes().front() == 0);
+    REQUIRE(pipeline.memoryBudget()->dropped() == 0);
+}
+
+} // namespace
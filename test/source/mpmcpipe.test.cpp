@@ -0,0 +1,118 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/MpmcQueue.h"
+#include "blpl/Pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+constexpr int numProducers = 4;
+constexpr int perProducer  = 10000;
+
+TEST_CASE("mpmc queue with several producers and consumers")
+{
+    MpmcQueue<int> queue(64);
+    REQUIRE(queue.capacity() == 64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < numProducers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                int value = p * perProducer + i;
+                while (!queue.tryPush(std::move(value)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::mutex mutex;
+    std::vector<int> popped;
+    std::atomic<int> remaining(numProducers * perProducer);
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 2; ++c) {
+        consumers.emplace_back([&] {
+            std::vector<int> local;
+            while (remaining > 0) {
+                if (auto value = queue.tryPop()) {
+                    local.push_back(*value);
+                    --remaining;
+                }
+            }
+            std::scoped_lock<std::mutex> lock(mutex);
+            popped.insert(popped.end(), local.begin(), local.end());
+        });
+    }
+
+    for (auto& thread : producers)
+        thread.join();
+    for (auto& thread : consumers)
+        thread.join();
+
+    // every element arrives exactly once
+    REQUIRE(queue.empty());
+    std::sort(popped.begin(), popped.end());
+    REQUIRE(popped.size() == size_t(numProducers * perProducer));
+    for (size_t i = 0; i < popped.size(); ++i)
+        REQUIRE(popped[i] == static_cast<int>(i));
+}
+
+class SummingSink : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        m_sum += in;
+        ++m_count;
+        return in;
+    }
+
+    std::atomic<long long> m_sum{0};
+    std::atomic<int> m_count{0};
+};
+
+TEST_CASE("several threads push into the in pipe of a pipeline")
+{
+    auto sink     = std::make_shared<SummingSink>();
+    auto pipeline = std::make_shared<FunctorFilter<int, int>>(
+                        [](int&& in) { return in; }) |
+                    sink;
+
+    REQUIRE(pipeline.setPipeCapacity(0, 256));
+    REQUIRE(pipeline.setPipeCapacity(1, 16));
+    REQUIRE_FALSE(pipeline.setPipeCapacity(3, 16));
+    pipeline.inPipe()->setWaitForSlowestFilter(true);
+    pipeline.start();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < numProducers; ++p) {
+        producers.emplace_back([&pipeline] {
+            for (int i = 1; i <= perProducer; ++i)
+                pipeline.inPipe()->push(int(i));
+        });
+    }
+    for (auto& thread : producers)
+        thread.join();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (sink->m_count < numProducers * perProducer &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pipeline.stop();
+
+    REQUIRE(sink->m_count == numProducers * perProducer);
+    REQUIRE(sink->m_sum ==
+            numProducers * (perProducer * (perProducer + 1LL) / 2));
+}
+
+} // namespace
@@ -1,6 +1,8 @@
 #include <blpl/Filter.h>
 #include <blpl/MultiFilter.h>
 
+#include <memory>
+
 #include <doctest/doctest.h>
 
 using namespace blpl;
@@ -40,6 +42,26 @@ public:
     int resetted = 0;
 };
 
+// move-only and not default-constructible
+struct Handle
+{
+    explicit Handle(int value)
+        : value(std::make_unique<int>(value))
+    {}
+
+    std::unique_ptr<int> value;
+};
+
+class HandleFilter : public Filter<Handle, Handle>
+{
+public:
+    Handle processImpl(Handle&& in) override
+    {
+        *in.value *= 2;
+        return std::move(in);
+    }
+};
+
 TEST_CASE("simple multifilter construction")
 {
     auto filter1     = std::make_shared<TestFilter1>();
@@ -93,6 +115,69 @@ TEST_CASE("simple multifilter process")
     REQUIRE(out[0] * out[1] == 4);
 }
 
+TEST_CASE("multifilter with move-only payload")
+{
+    auto multifilter = std::make_shared<HandleFilter>() &
+                       std::make_shared<HandleFilter>() &
+                       std::make_shared<HandleFilter>();
+
+    std::vector<Handle> in;
+    for (int i = 0; i < 3; ++i)
+        in.emplace_back(i);
+    std::vector<Handle> out = multifilter.process(std::move(in));
+
+    REQUIRE(out.size() == 3);
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(*out[i].value == 2 * i);
+
+    // too few inputs
+    in.clear();
+    in.emplace_back(1);
+    REQUIRE(multifilter.process(std::move(in)).empty());
+}
+
+TEST_CASE("multifilter with dynamic scheduling")
+{
+    auto multifilter = std::make_shared<HandleFilter>() &
+                       std::make_shared<HandleFilter>() &
+                       std::make_shared<HandleFilter>();
+
+    for (auto scheduling :
+         {MultiFilterScheduling::Dynamic, MultiFilterScheduling::Guided}) {
+        multifilter.setScheduling(scheduling, 2);
+        multifilter.resetLaneMetrics();
+
+        std::vector<Handle> in;
+        for (int i = 0; i < 100; ++i)
+            in.emplace_back(i);
+        std::vector<Handle> out = multifilter.process(std::move(in));
+
+        REQUIRE(out.size() == 100);
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(*out[i].value == 2 * i);
+
+        uint32_t processed = 0;
+        for (auto& metrics : multifilter.laneMetrics())
+            processed += metrics.counter;
+        REQUIRE(processed == 100);
+    }
+}
+
+TEST_CASE("lockstep multifilter lane metrics")
+{
+    auto multifilter =
+        std::make_shared<TestFilter1>() & std::make_shared<TestFilter2>();
+    REQUIRE(multifilter.scheduling() == MultiFilterScheduling::Lockstep);
+
+    multifilter.process(std::vector<int>(2, 1));
+    multifilter.process(std::vector<int>(2, 1));
+
+    auto metrics = multifilter.laneMetrics();
+    REQUIRE(metrics.size() == 2);
+    REQUIRE(metrics[0].counter == 2);
+    REQUIRE(metrics[1].counter == 2);
+}
+
 TEST_CASE("reset")
 {
     auto filter1     = std::make_shared<TestFilter1>();
@@ -0,0 +1,122 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class CountingSource : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        return m_i++;
+    }
+
+    int m_i = 0;
+};
+
+std::shared_ptr<FunctorFilter<int, int>> makeIdentity()
+{
+    return std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return in; });
+}
+
+template <class Predicate>
+bool waitUntil(Predicate predicate)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return predicate();
+}
+
+TEST_CASE("output callback")
+{
+    auto pipeline = std::make_shared<CountingSource>() | makeIdentity();
+
+    std::mutex mutex;
+    std::vector<int> received;
+    pipeline.setOutputCallback([&](int&& out) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        received.push_back(out);
+    });
+
+    pipeline.start();
+    REQUIRE(waitUntil([&] {
+        std::scoped_lock<std::mutex> lock(mutex);
+        return received.size() >= 100;
+    }));
+    pipeline.stop();
+
+    // every result is delivered and nothing lands in the out pipe
+    REQUIRE(pipeline.outPipe()->size() == 0);
+    for (size_t i = 0; i < received.size(); ++i)
+        REQUIRE(received[i] == static_cast<int>(i));
+}
+
+TEST_CASE("batched output callback")
+{
+    auto pipeline = makeIdentity() | makeIdentity();
+
+    std::mutex mutex;
+    std::vector<std::vector<int>> batches;
+    pipeline.setOutputCallback(4, [&](std::vector<int>&& batch) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        batches.push_back(std::move(batch));
+    });
+    pipeline.start();
+
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(pipeline.pushFor(int(i), std::chrono::seconds(1)));
+
+    // the incomplete batch is flushed once the pipeline runs dry
+    std::vector<int> received;
+    REQUIRE(waitUntil([&] {
+        std::scoped_lock<std::mutex> lock(mutex);
+        received.clear();
+        for (auto& batch : batches) {
+            REQUIRE(!batch.empty());
+            REQUIRE(batch.size() <= 4);
+            received.insert(received.end(), batch.begin(), batch.end());
+        }
+        return received.size() == 10;
+    }));
+    pipeline.stop();
+
+    for (size_t i = 0; i < received.size(); ++i)
+        REQUIRE(received[i] == static_cast<int>(i));
+}
+
+TEST_CASE("output futures")
+{
+    auto pipeline = makeIdentity() | makeIdentity();
+    auto first    = pipeline.nextOutput();
+    auto second   = pipeline.nextOutput();
+    pipeline.start();
+
+    pipeline.inPipe()->push(1);
+    REQUIRE(first.get() == 1);
+    pipeline.inPipe()->push(2);
+    REQUIRE(second.get() == 2);
+
+    // results nobody asked for are stored in the out pipe
+    pipeline.inPipe()->push(3);
+    REQUIRE(waitUntil([&] { return pipeline.outPipe()->size() == 1; }));
+    REQUIRE(pipeline.outPipe()->pop() == 3);
+
+    pipeline.stop();
+}
+
+} // namespace
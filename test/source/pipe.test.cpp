@@ -3,10 +3,38 @@
 #include <doctest/doctest.h>
 
 #include <chrono> // std::chrono::seconds
+#include <memory> // std::unique_ptr
 #include <thread> // std::this_thread::sleep_for
 
 using namespace blpl;
 
+namespace {
+
+// move-only and not default-constructible, counts its live instances
+struct Handle
+{
+    explicit Handle(int value)
+        : value(std::make_unique<int>(value))
+    {
+        ++alive;
+    }
+    Handle(Handle&& other) noexcept
+        : value(std::move(other.value))
+    {
+        ++alive;
+    }
+    Handle& operator=(Handle&&) = default;
+    ~Handle()
+    {
+        --alive;
+    }
+
+    std::unique_ptr<int> value;
+    static inline int alive = 0;
+};
+
+} // namespace
+
 TEST_CASE("construction")
 {
     Pipe<int> pipe;
@@ -139,3 +167,119 @@ TEST_CASE("push callback")
     pipe.push(1);
     REQUIRE(i == 2);
 }
+
+TEST_CASE("move-only payload")
+{
+    {
+        Pipe<Handle> pipe;
+        REQUIRE_FALSE(pipe.tryPop());
+
+        pipe.push(Handle(1));
+        REQUIRE(pipe.size() == 1);
+        REQUIRE(Handle::alive == 1);
+
+        auto data = pipe.tryPop();
+        REQUIRE(data);
+        REQUIRE(*data->value == 1);
+        REQUIRE(pipe.size() == 0);
+        REQUIRE_FALSE(pipe.tryPop());
+
+        pipe.push(Handle(2));
+        REQUIRE(*pipe.pop().value == 2);
+    }
+    REQUIRE(Handle::alive == 0);
+}
+
+TEST_CASE("move-only payload lifetime")
+{
+    {
+        Pipe<Handle> pipe(false);
+        pipe.push(Handle(1));
+        pipe.push(Handle(2));
+        REQUIRE(Handle::alive == 1);
+
+        pipe.reset();
+        REQUIRE(Handle::alive == 0);
+
+        pipe.push(Handle(3));
+    }
+    // the destructor of the pipe destroys the remaining element
+    REQUIRE(Handle::alive == 0);
+}
+
+TEST_CASE("blocking try pop")
+{
+    Pipe<Handle> pipe;
+    std::optional<Handle> data;
+    std::thread thread([&pipe, &data]() { data = pipe.blockingTryPop(); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pipe.push(Handle(1));
+    thread.join();
+    REQUIRE(data);
+    REQUIRE(*data->value == 1);
+
+    std::thread thread2([&pipe, &data]() { data = pipe.blockingTryPop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pipe.disable();
+    thread2.join();
+    REQUIRE_FALSE(data);
+}
+
+TEST_CASE("queued pipe")
+{
+    Pipe<int> pipe(false, 3);
+    REQUIRE(pipe.capacity() == 4);
+
+    for (int i = 0; i < 6; ++i)
+        pipe.push(int(i));
+    REQUIRE(pipe.size() == 4);
+
+    // the discarding pipe dropped the oldest elements
+    for (int i = 2; i < 6; ++i)
+        REQUIRE(pipe.pop() == i);
+    REQUIRE_FALSE(pipe.tryPop());
+
+    REQUIRE(pipe.setCapacity(0));
+    REQUIRE(pipe.capacity() == 1);
+}
+
+TEST_CASE("queued pipe waiting")
+{
+    Pipe<int> pipe(true, 2);
+    pipe.push(1);
+    pipe.push(2);
+
+    std::atomic<bool> threadActive(true);
+    std::thread thread([&pipe, &threadActive]() {
+        pipe.push(3);
+        threadActive = false;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(threadActive);
+    REQUIRE(pipe.pop() == 1);
+    thread.join();
+    REQUIRE(pipe.size() == 2);
+    REQUIRE(pipe.pop() == 2);
+    REQUIRE(pipe.pop() == 3);
+}
+
+TEST_CASE("queued pipe move-only payload lifetime")
+{
+    {
+        Pipe<Handle> pipe(false, 2);
+        pipe.push(Handle(1));
+        pipe.push(Handle(2));
+        pipe.push(Handle(3));
+        REQUIRE(Handle::alive == 2);
+        REQUIRE(*pipe.pop().value == 2);
+
+        pipe.reset();
+        REQUIRE(Handle::alive == 0);
+
+        pipe.push(Handle(4));
+    }
+    // the destructor of the pipe destroys the remaining element
+    REQUIRE(Handle::alive == 0);
+}
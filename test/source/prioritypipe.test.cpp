@@ -0,0 +1,151 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/Pipeline.h"
+#include "blpl/PriorityQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+struct Request
+{
+    bool urgent;
+    int id;
+};
+
+} // namespace
+
+template <>
+struct blpl::PriorityOf<Request>
+{
+    static size_t of(const Request& request) noexcept
+    {
+        return request.urgent ? 1 : 0;
+    }
+};
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+TEST_CASE("priority queue takes the most urgent element first")
+{
+    PriorityQueue<Request> queue(2, 8, 0);
+    REQUIRE(queue.levels() == 2);
+    REQUIRE(queue.capacity() == 16);
+
+    queue.tryPush(Request{false, 0});
+    queue.tryPush(Request{false, 1});
+    queue.tryPush(Request{true, 2});
+    REQUIRE(queue.size() == 3);
+
+    REQUIRE(queue.tryPop()->id == 2);
+    REQUIRE(queue.tryPop()->id == 0);
+    REQUIRE(queue.tryPop()->id == 1);
+    REQUIRE_FALSE(queue.tryPop());
+
+    auto metrics = queue.metrics();
+    REQUIRE(metrics.size() == 2);
+    REQUIRE(metrics[0].counter == 2);
+    REQUIRE(metrics[1].counter == 1);
+    REQUIRE(metrics[1].promoted == 0);
+    REQUIRE(metrics[0].maxLatency >= metrics[0].meanLatency);
+    REQUIRE(metrics[0].p99Latency <= metrics[0].maxLatency);
+}
+
+TEST_CASE("priority queue keeps bulk elements from starving")
+{
+    PriorityQueue<Request> queue(2, 16, 3);
+    for (int i = 0; i < 4; ++i)
+        queue.tryPush(Request{false, i});
+    for (int i = 0; i < 8; ++i)
+        queue.tryPush(Request{true, 100 + i});
+
+    // every third pop serves the waiting bulk level
+    std::vector<int> order;
+    while (auto request = queue.tryPop())
+        order.push_back(request->id);
+    REQUIRE(order.size() == 12);
+    REQUIRE(order[0] == 100);
+    REQUIRE(order[1] == 101);
+    REQUIRE(order[2] == 0);
+    REQUIRE(queue.metrics()[0].promoted >= 2);
+}
+
+TEST_CASE("pipe with priority levels")
+{
+    Pipe<Request> pipe(false);
+    REQUIRE(pipe.setPriorityLevels(2, 2, 0));
+    REQUIRE(pipe.capacity() == 4);
+
+    pipe.push(Request{false, 0});
+    pipe.push(Request{false, 1});
+    pipe.push(Request{true, 2});
+    // a full level drops its own oldest element, never a more urgent one
+    pipe.push(Request{false, 3});
+    REQUIRE(pipe.size() == 3);
+
+    REQUIRE(pipe.pop().id == 2);
+    REQUIRE(pipe.pop().id == 1);
+    REQUIRE(pipe.pop().id == 3);
+    REQUIRE_FALSE(pipe.tryPop());
+    REQUIRE(pipe.priorityMetrics()[0].counter == 2);
+
+    // back to a single slot
+    REQUIRE(pipe.setPriorityLevels(1, 2, 0));
+    REQUIRE(pipe.capacity() == 1);
+    REQUIRE(pipe.priorityMetrics().empty());
+}
+
+TEST_CASE("urgent elements overtake bulk ones in a pipeline")
+{
+    std::atomic<bool> open(false);
+    auto gate = std::make_shared<FunctorFilter<Request, Request>>(
+        [&open](Request&& in) {
+            while (!open)
+                std::this_thread::yield();
+            return in;
+        });
+    auto identity = std::make_shared<FunctorFilter<Request, Request>>(
+        [](Request&& in) { return in; });
+
+    auto pipeline = gate | identity;
+    for (size_t stage = 0; stage <= pipeline.length(); ++stage)
+        REQUIRE(pipeline.setPipePriorities(stage, 2, 64, 0));
+    pipeline.start();
+
+    // the gate holds one element while bulk and urgent ones queue up
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(pipeline.tryPush(Request{false, i}));
+    while (pipeline.inPipe()->size() > 9)
+        std::this_thread::yield();
+    REQUIRE(pipeline.tryPush(Request{true, 100}));
+    open = true;
+
+    std::vector<int> order;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (order.size() < 11 && std::chrono::steady_clock::now() < deadline) {
+        if (auto out = pipeline.outPipe()->tryPop())
+            order.push_back(out->id);
+        else
+            std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    REQUIRE(order.size() == 11);
+    // at most the element in the gate got out ahead of the urgent one
+    auto urgent = std::find(order.begin(), order.end(), 100);
+    REQUIRE(urgent - order.begin() <= 1);
+    REQUIRE(pipeline.pipePriorityMetrics(0)[1].counter == 1);
+    REQUIRE(pipeline.pipePriorityMetrics(0)[0].counter == 10);
+}
+
+} // namespace
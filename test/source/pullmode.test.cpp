@@ -0,0 +1,155 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class CountingSource : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        return m_calls++;
+    }
+
+    std::atomic<int> m_calls{0};
+};
+
+std::shared_ptr<FunctorFilter<int, int>> makeDoubler()
+{
+    return std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return 2 * in; });
+}
+
+template <class Predicate>
+bool waitUntil(Predicate predicate)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    return predicate();
+}
+
+TEST_CASE("a pipeline in pull mode only computes requested results")
+{
+    auto source   = std::make_shared<CountingSource>();
+    auto pipeline = source | makeDoubler() | makeDoubler();
+    REQUIRE(pipeline.setPullMode(true));
+    pipeline.start();
+
+    // nobody asks for results, so the source never runs
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(source->m_calls == 0);
+
+    for (int i = 0; i < 5; ++i) {
+        auto out = pipeline.pullFor(std::chrono::seconds(5));
+        REQUIRE(out);
+        REQUIRE(*out == 4 * i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(source->m_calls == 5);
+    REQUIRE(pipeline.outPipe()->demand() == 0);
+
+    pipeline.stop();
+    REQUIRE(pipeline.setPullMode(false));
+}
+
+TEST_CASE("pull mode requests input and answers from the cache")
+{
+    auto first    = makeDoubler();
+    auto pipeline = first | makeDoubler();
+    pipeline.setPipeCapacity(0, 4);
+    REQUIRE(pipeline.setPullMode(true));
+    REQUIRE(pipeline.setStageCache(1, true));
+    REQUIRE_FALSE(pipeline.setStageCache(2, true));
+
+    pipeline.start();
+    REQUIRE(pipeline.tryPush(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(pipeline.metrics()[0].counter == 0);
+    REQUIRE(pipeline.pullFor(std::chrono::seconds(5)) == std::optional<int>(4));
+
+    // without input the last result is repeated, while the request for a new
+    // one reaches the in pipe of the pipeline
+    REQUIRE(pipeline.pullFor(std::chrono::seconds(5)) == std::optional<int>(4));
+    REQUIRE(waitUntil([&] { return pipeline.inPipe()->demand() == 1; }));
+
+    REQUIRE(pipeline.tryPush(3));
+    REQUIRE(waitUntil([&] { return pipeline.metrics()[0].counter == 2; }));
+    REQUIRE(pipeline.inPipe()->demand() == 0);
+    REQUIRE(pipeline.pullFor(std::chrono::seconds(5))
+            == std::optional<int>(12));
+    pipeline.stop();
+
+    auto metrics = pipeline.metrics();
+    REQUIRE(metrics[0].counter == 2);
+    REQUIRE(metrics[1].counter == 2);
+}
+
+TEST_CASE("concurrent pulls request a result each")
+{
+    auto source   = std::make_shared<CountingSource>();
+    auto pipeline = source | makeDoubler();
+    // a single slot would only keep the latest of the results requested
+    pipeline.setPipeCapacity(1, 8);
+    pipeline.setPipeCapacity(2, 8);
+    REQUIRE(pipeline.setPullMode(true));
+    pipeline.start();
+
+    std::mutex mutex;
+    std::vector<int> results;
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 4; ++i) {
+        consumers.emplace_back([&] {
+            for (int j = 0; j < 10; ++j) {
+                auto out = pipeline.pullFor(std::chrono::seconds(5));
+                std::scoped_lock<std::mutex> lock(mutex);
+                if (out)
+                    results.push_back(*out);
+            }
+        });
+    }
+    for (auto& consumer : consumers)
+        consumer.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pipeline.stop();
+
+    std::sort(results.begin(), results.end());
+    REQUIRE(results.size() == 40);
+    for (int i = 0; i < 40; ++i)
+        REQUIRE(results[i] == 2 * i);
+    REQUIRE(source->m_calls == 40);
+}
+
+TEST_CASE("a pull that times out withdraws its request")
+{
+    auto pipeline = makeDoubler() | makeDoubler();
+    REQUIRE(pipeline.setPullMode(true));
+    pipeline.start();
+
+    REQUIRE_FALSE(pipeline.pullFor(std::chrono::milliseconds(10)));
+    REQUIRE(pipeline.outPipe()->demand() == 0);
+
+    // the last stage waits for a new request, the first one still has one
+    REQUIRE(pipeline.tryPush(1));
+    REQUIRE(waitUntil([&] { return pipeline.metrics()[0].counter == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(pipeline.metrics()[1].counter == 0);
+    REQUIRE(pipeline.pullFor(std::chrono::seconds(5)) == std::optional<int>(4));
+    pipeline.stop();
+}
+
+} // namespace
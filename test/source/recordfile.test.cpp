@@ -0,0 +1,200 @@
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <blpl/MappedRecordSource.h>
+#include <blpl/Pipeline.h>
+#include <blpl/RecordFileSink.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+namespace {
+
+std::string tempFile(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("blpl_" + name))
+        .string();
+}
+
+TEST_CASE("mapped fixed size records")
+{
+    auto path = tempFile("fixed.bin");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "aaaabbbbccccdd";
+    }
+
+    MappedRecordSource source(path, 4);
+    REQUIRE(source.isOpen());
+
+    REQUIRE(source.process(Generator()).asStringView() == "aaaa");
+    REQUIRE(source.process(Generator()).asStringView() == "bbbb");
+    REQUIRE_FALSE(source.atEnd());
+    REQUIRE(source.process(Generator()).asStringView() == "cccc");
+
+    // the truncated record at the end is ignored
+    REQUIRE(source.atEnd());
+    REQUIRE(source.process(Generator()).empty());
+
+    source.reset();
+    REQUIRE(source.process(Generator()).asStringView() == "aaaa");
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("mapped missing file")
+{
+    MappedRecordSource source(tempFile("does_not_exist.bin"), 4);
+    REQUIRE_FALSE(source.isOpen());
+    REQUIRE(source.atEnd());
+    REQUIRE(source.process(Generator()).empty());
+}
+
+TEST_CASE("length-prefixed records round trip")
+{
+    auto path = tempFile("prefixed.bin");
+    {
+        RecordFileSink sink(path, true);
+        REQUIRE(sink.isOpen());
+
+        std::string first  = "first record";
+        std::string second = "2nd";
+        REQUIRE(sink.process(RecordView(first.data(), first.size())) ==
+                sizeof(std::uint32_t) + first.size());
+        sink.process(RecordView(second.data(), second.size()));
+    }
+
+    MappedRecordSource source(path);
+    REQUIRE(source.process(Generator()).asStringView() == "first record");
+    REQUIRE(source.process(Generator()).asStringView() == "2nd");
+    REQUIRE(source.atEnd());
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("sink reports failed writes")
+{
+    std::string record(3000, 'x');
+    {
+        auto path = tempFile("closed.bin");
+        RecordFileSink sink(path, false, RecordFileSink::Mode::Buffered, 4096);
+        sink.process(RecordView(record.data(), record.size()));
+        REQUIRE(sink.good());
+        REQUIRE(sink.close());
+        REQUIRE_FALSE(sink.isOpen());
+        REQUIRE(std::filesystem::file_size(path) == record.size());
+        std::filesystem::remove(path);
+    }
+
+    if (!std::filesystem::exists("/dev/full"))
+        return;
+
+    // every write to /dev/full fails with ENOSPC
+    RecordFileSink sink("/dev/full", false, RecordFileSink::Mode::Buffered,
+                        4096);
+    REQUIRE(sink.isOpen());
+    sink.process(RecordView(record.data(), record.size()));
+    REQUIRE(sink.good());
+
+    // fills the buffer, so the first write happens
+    sink.process(RecordView(record.data(), record.size()));
+    REQUIRE_FALSE(sink.good());
+    REQUIRE(sink.isOpen());
+    REQUIRE_FALSE(sink.flush());
+
+    // the failure is sticky, even when nothing is left to write
+    sink.process(RecordView(record.data(), record.size()));
+    REQUIRE_FALSE(sink.flush());
+    REQUIRE_FALSE(sink.close());
+}
+
+TEST_CASE("direct sink")
+{
+    auto path = tempFile("direct.bin");
+    std::string record(1000, 'x');
+    {
+        RecordFileSink sink(path, false, RecordFileSink::Mode::Direct, 4096);
+        for (int i = 0; i < 10; ++i)
+            sink.process(RecordView(record.data(), record.size()));
+
+        // flushing in between must not leave padding in the file
+        sink.flush();
+        REQUIRE(std::filesystem::file_size(path) == 10000);
+        for (int i = 0; i < 10; ++i)
+            sink.process(RecordView(record.data(), record.size()));
+    }
+    REQUIRE(std::filesystem::file_size(path) == 20000);
+
+    MappedRecordSource source(path, 1000);
+    int count = 0;
+    while (!source.atEnd()) {
+        REQUIRE(source.process(Generator()).asStringView() == record);
+        ++count;
+    }
+    REQUIRE(count == 20);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("record file pipeline")
+{
+    auto inPath  = tempFile("pipeline_in.bin");
+    auto outPath = tempFile("pipeline_out.bin");
+    {
+        std::ofstream file(inPath, std::ios::binary);
+        for (int i = 0; i < 100; ++i)
+            file << "0123456789";
+    }
+
+    SUBCASE("plain records")
+    {
+        auto sink     = std::make_shared<RecordFileSink>(outPath);
+        auto pipeline = std::make_shared<MappedRecordSource>(inPath, 10) | sink;
+        pipeline.outPipe()->setWaitForSlowestFilter(true);
+
+        pipeline.start();
+        while (pipeline.outPipe()->blockingPop() < 1000)
+            ;
+        // the empty records after the end of the input add nothing
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pipeline.stop();
+        sink->flush();
+
+        REQUIRE(std::filesystem::file_size(outPath) == 1000);
+    }
+    SUBCASE("length-prefixed records")
+    {
+        const uint64_t size = 100 * (sizeof(std::uint32_t) + 10);
+        auto sink     = std::make_shared<RecordFileSink>(outPath, true);
+        auto pipeline = std::make_shared<MappedRecordSource>(inPath, 10) | sink;
+        pipeline.outPipe()->setWaitForSlowestFilter(true);
+
+        pipeline.start();
+        while (pipeline.outPipe()->blockingPop() < size)
+            ;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pipeline.stop();
+        sink->flush();
+
+        REQUIRE(std::filesystem::file_size(outPath) == size);
+        MappedRecordSource source(outPath);
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(source.process(Generator()).asStringView() ==
+                    "0123456789");
+        REQUIRE(source.atEnd());
+    }
+
+    std::filesystem::remove(inPath);
+    std::filesystem::remove(outPath);
+}
+
+} // namespace
+
+#endif
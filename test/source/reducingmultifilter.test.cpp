@@ -0,0 +1,135 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/MultiFilter.h"
+#include "blpl/ReducingMultiFilter.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class ToString : public Filter<int, std::string>
+{
+public:
+    std::string processImpl(int&& in) override
+    {
+        return std::to_string(in);
+    }
+};
+
+MultiFilter<int, std::string> makeLanes(size_t numLanes)
+{
+    std::vector<std::shared_ptr<ToString>> filters;
+    for (size_t i = 0; i < numLanes; ++i)
+        filters.push_back(std::make_shared<ToString>());
+    return MultiFilter<int, std::string>(filters);
+}
+
+std::string concat(std::string&& a, std::string&& b)
+{
+    return a + "," + b;
+}
+
+TEST_CASE("reducing multifilter keeps the order of an associative combine")
+{
+    for (size_t numLanes : {1, 2, 5, 8, 13}) {
+        auto filter = makeReducingMultiFilter(makeLanes(numLanes), concat);
+        REQUIRE(filter.numParallel() == numLanes);
+
+        std::vector<int> in;
+        std::string expected;
+        for (size_t i = 0; i < numLanes; ++i) {
+            in.push_back(static_cast<int>(i));
+            expected += (i > 0 ? "," : "") + std::to_string(i);
+        }
+
+        REQUIRE(filter.process(std::move(in)) == expected);
+    }
+}
+
+TEST_CASE("reducing multifilter with fewer inputs than lanes")
+{
+    ReducingMultiFilter<int, std::string> filter(makeLanes(4), concat);
+
+    REQUIRE(filter.process({7, 8}) == "7,8");
+    REQUIRE(filter.process({}).empty());
+}
+
+TEST_CASE("reducing multifilter with move-only results")
+{
+    auto lane = makeFunctorFilter<int>(
+        [](int&& in) { return std::make_unique<int>(in); });
+
+    std::vector<std::shared_ptr<decltype(lane)>> lanes;
+    for (int i = 0; i < 4; ++i)
+        lanes.push_back(std::make_shared<decltype(lane)>(lane));
+    auto multi = MultiFilter<int, std::unique_ptr<int>>(lanes);
+
+    auto sum = makeReducingMultiFilter(
+        multi, [](std::unique_ptr<int>&& a, std::unique_ptr<int>&& b) {
+            *a += *b;
+            return std::move(a);
+        });
+
+    REQUIRE(*sum.process({1, 2, 3, 4}) == 10);
+}
+
+TEST_CASE("reducing multifilter passes on the exception of a lane")
+{
+    auto lane = makeFunctorFilter<int>([](int&& in) {
+        if (in < 0)
+            throw std::runtime_error("negative");
+        return std::to_string(in);
+    });
+    std::vector<std::shared_ptr<decltype(lane)>> lanes;
+    for (int i = 0; i < 5; ++i)
+        lanes.push_back(std::make_shared<decltype(lane)>(lane));
+    auto filter =
+        makeReducingMultiFilter(MultiFilter<int, std::string>(lanes), concat);
+
+    REQUIRE_THROWS_AS(filter.process({-1, 1, 2, 3, 4}), std::runtime_error);
+    REQUIRE_THROWS_AS(filter.process({0, 1, 2, -3, 4}), std::runtime_error);
+    REQUIRE(filter.process({0, 1, 2, 3, 4}) == "0,1,2,3,4");
+
+    auto picky = makeReducingMultiFilter(
+        MultiFilter<int, std::string>(lanes),
+        [](std::string&& a, std::string&& b) {
+            if (b == "3")
+                throw std::invalid_argument(b);
+            return a + b;
+        });
+    REQUIRE_THROWS_AS(picky.process({0, 1, 2, 3}), std::invalid_argument);
+    REQUIRE(picky.process({0, 1, 2, 4}) == "0124");
+}
+
+TEST_CASE("reducing multifilter without a default result")
+{
+    struct Sum
+    {
+        explicit Sum(int value)
+            : value(value)
+        {}
+
+        int value;
+    };
+
+    auto lane = makeFunctorFilter<int>([](int&& in) { return Sum(in); });
+    std::vector<std::shared_ptr<decltype(lane)>> lanes;
+    for (int i = 0; i < 2; ++i)
+        lanes.push_back(std::make_shared<decltype(lane)>(lane));
+
+    auto sum = makeReducingMultiFilter(
+        MultiFilter<int, Sum>(lanes),
+        [](Sum&& a, Sum&& b) { return Sum(a.value + b.value); });
+
+    REQUIRE(sum.process({1, 2}).value == 3);
+    REQUIRE_THROWS_AS(sum.process({}), std::invalid_argument);
+}
+
+} // namespace
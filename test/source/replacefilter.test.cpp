@@ -0,0 +1,107 @@
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class CountingSource : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        return m_i++;
+    }
+
+    int m_i = 0;
+};
+
+class AddFilter : public Filter<int, int>
+{
+public:
+    explicit AddFilter(int summand)
+        : m_summand(summand)
+    {}
+
+    int processImpl(int&& in) override
+    {
+        return in + m_summand;
+    }
+
+private:
+    int m_summand;
+};
+
+class StringFilter : public Filter<int, std::string>
+{
+public:
+    std::string processImpl(int&& in) override
+    {
+        return std::to_string(in);
+    }
+};
+
+class RecordingSink : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_received.push_back(in);
+        return in;
+    }
+
+    std::vector<int> received()
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_received;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<int> m_received;
+};
+
+TEST_CASE("replace a filter while the pipeline is running")
+{
+    auto source   = std::make_shared<CountingSource>();
+    auto sink     = std::make_shared<RecordingSink>();
+    auto pipeline = source | std::make_shared<AddFilter>(0) | sink;
+
+    REQUIRE_FALSE(pipeline.replaceFilter(1, std::make_shared<StringFilter>()));
+    REQUIRE_FALSE(pipeline.replaceFilter(3, std::make_shared<AddFilter>(1)));
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    auto replacement = std::make_shared<AddFilter>(1000);
+    REQUIRE(pipeline.replaceFilter(1, replacement));
+    REQUIRE(*std::next(pipeline.filters().begin()) == replacement);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pipeline.stop();
+
+    // no element is lost or processed twice and the switch happens once
+    auto received   = sink->received();
+    size_t switched = 0;
+    while (switched < received.size() && received[switched] < 1000)
+        ++switched;
+    REQUIRE(switched > 0);
+    REQUIRE(switched < received.size());
+    for (size_t i = 0; i < received.size(); ++i) {
+        int expected = static_cast<int>(i) + (i < switched ? 0 : 1000);
+        REQUIRE(received[i] == expected);
+    }
+}
+
+} // namespace
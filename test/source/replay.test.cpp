@@ -0,0 +1,188 @@
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <blpl/FunctorFilter.h>
+#include <blpl/Pipeline.h>
+#include <blpl/Replay.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+std::string tempFile(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("blpl_" + name))
+        .string();
+}
+
+template <class T>
+std::optional<T> roundTrip(const T& value)
+{
+    std::string bytes;
+    Serializer<T>::serialize(value, bytes);
+    return Serializer<T>::deserialize(RecordView(bytes.data(), bytes.size()));
+}
+
+struct Point
+{
+    int x;
+    double y;
+};
+
+class CollectingFilter : public Filter<std::string, size_t>
+{
+public:
+    size_t processImpl(std::string&& in) override
+    {
+        m_inputs.push_back(in);
+        return in.size();
+    }
+
+    std::vector<std::string> m_inputs;
+};
+
+std::shared_ptr<FunctorFilter<size_t, int>> makeToInt()
+{
+    return std::make_shared<FunctorFilter<size_t, int>>(
+        [](size_t&& in) { return static_cast<int>(in); });
+}
+
+TEST_CASE("serializers round trip")
+{
+    REQUIRE(roundTrip(42) == 42);
+    REQUIRE(roundTrip(std::string("replay")) == "replay");
+    std::vector<int> vector{1, 2, 3};
+    REQUIRE(roundTrip(vector) == vector);
+
+    auto point = roundTrip(Point{1, 2.5});
+    REQUIRE(point);
+    REQUIRE(point->x == 1);
+    REQUIRE(point->y == 2.5);
+
+    // the size has to match
+    REQUIRE_FALSE(Serializer<int>::deserialize(RecordView("abc", 3)));
+}
+
+TEST_CASE("record the inputs of a pipeline stage and replay them")
+{
+    auto path = tempFile("replay.log");
+    auto collecting = std::make_shared<CollectingFilter>();
+    {
+        auto recording =
+            std::make_shared<RecordingFilter<std::string, size_t>>(collecting,
+                                                                   path);
+        REQUIRE(recording->isOpen());
+
+        auto pipeline = recording | makeToInt();
+        pipeline.setPipeCapacity(0, 16);
+        pipeline.start();
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(pipeline.pushFor(std::to_string(i),
+                                     std::chrono::seconds(1)));
+
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (recording->recorded() < 100 &&
+               std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pipeline.stop();
+        REQUIRE(recording->recorded() == 100);
+        REQUIRE(recording->flush());
+        REQUIRE(recording->good());
+    }
+    REQUIRE(collecting->m_inputs.size() == 100);
+
+    ReplayDriver<std::string> driver(path, ReplayRate::Maximum);
+    REQUIRE(driver.isValid());
+
+    CollectingFilter replayed;
+    REQUIRE(driver.replayInto(replayed) == 100);
+    REQUIRE(replayed.m_inputs == collecting->m_inputs);
+    REQUIRE(driver.malformed() == 0);
+
+    // and once more into a pipeline
+    auto replayedPtr = std::make_shared<CollectingFilter>();
+    auto pipeline    = replayedPtr | makeToInt();
+    pipeline.start();
+    REQUIRE(driver.replayInto(pipeline) == 100);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pipeline.inPipe()->size() > 0 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pipeline.stop();
+    REQUIRE(replayedPtr->m_inputs.size() == 100);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("replay at the original rate")
+{
+    auto path = tempFile("replay_rate.log");
+    {
+        auto recording = makeRecordingFilter(
+            std::make_shared<FunctorFilter<int, int>>([](int&& in) {
+                return in;
+            }),
+            path);
+        for (int i = 0; i < 3; ++i) {
+            recording.process(int(i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    ReplayDriver<int> driver(path);
+    std::vector<int> inputs;
+    auto start = std::chrono::steady_clock::now();
+    driver.replay([&](int&& in) {
+        inputs.push_back(in);
+        return true;
+    });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE((inputs == std::vector<int>{0, 1, 2}));
+    REQUIRE(elapsed >= std::chrono::milliseconds(40));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("invalid and truncated replay logs")
+{
+    REQUIRE_FALSE(ReplayDriver<int>(tempFile("replay_missing.log")).isValid());
+
+    auto path = tempFile("replay_truncated.log");
+    {
+        auto recording = makeRecordingFilter(
+            std::make_shared<FunctorFilter<int, int>>([](int&& in) {
+                return in;
+            }),
+            path);
+        recording.process(1);
+        recording.process(2);
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    ReplayDriver<int> driver(path, ReplayRate::Maximum);
+    std::vector<int> inputs;
+    driver.replay([&](int&& in) {
+        inputs.push_back(in);
+        return true;
+    });
+    REQUIRE(inputs == std::vector<int>{1});
+
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+#endif
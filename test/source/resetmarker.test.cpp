@@ -0,0 +1,169 @@
+#include "blpl/Pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class CountingSource : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        return m_i++;
+    }
+
+    void reset() override
+    {
+        m_i = 0;
+        ++m_resets;
+    }
+
+    int m_i      = 0;
+    int m_resets = 0;
+};
+
+class NumberingFilter : public Filter<int, int>
+{
+public:
+    int processImpl(int&&) override
+    {
+        return m_count++;
+    }
+
+    void reset() override
+    {
+        m_count = 0;
+        ++m_resets;
+    }
+
+    int m_count  = 0;
+    int m_resets = 0;
+};
+
+/// records the incoming elements and -1 when it is reset
+class RecordingSink : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_received.push_back(in);
+        return in;
+    }
+
+    void reset() override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_received.push_back(-1);
+    }
+
+    std::vector<int> received()
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_received;
+    }
+
+    bool waitForReset()
+    {
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto received = this->received();
+            for (size_t i = 0; i + 10 < received.size(); ++i) {
+                if (received[i] == -1)
+                    return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<int> m_received;
+};
+
+/**
+ * @brief Checks that the sink saw one consecutive run of numbers before its
+ * reset and one starting at 0 after it.
+ */
+void requireResetInOrder(const std::vector<int>& received)
+{
+    size_t marker = 0;
+    while (marker < received.size() && received[marker] != -1)
+        ++marker;
+    REQUIRE(marker > 0);
+    REQUIRE(marker < received.size());
+
+    for (size_t i = 1; i < marker; ++i)
+        REQUIRE(received[i] == received[i - 1] + 1);
+    for (size_t i = marker + 1; i < received.size(); ++i)
+        REQUIRE(received[i] == static_cast<int>(i - marker - 1));
+}
+
+TEST_CASE("reset markers reset the stages in order")
+{
+    auto source    = std::make_shared<CountingSource>();
+    auto numbering = std::make_shared<NumberingFilter>();
+    auto sink      = std::make_shared<RecordingSink>();
+    auto pipeline  = source | numbering | sink;
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    REQUIRE(pipeline.resetStages(1, 2));
+    REQUIRE(sink->waitForReset());
+    pipeline.stop();
+
+    REQUIRE(source->m_resets == 0);
+    REQUIRE(numbering->m_resets == 1);
+    requireResetInOrder(sink->received());
+}
+
+TEST_CASE("reset markers can drop the pending elements")
+{
+    auto source    = std::make_shared<CountingSource>();
+    auto numbering = std::make_shared<NumberingFilter>();
+    auto sink      = std::make_shared<RecordingSink>();
+    auto pipeline  = source | numbering | sink;
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // the count is clamped to the length of the pipeline
+    REQUIRE(pipeline.resetStages(0, 10, false));
+    REQUIRE(sink->waitForReset());
+    pipeline.stop();
+
+    REQUIRE(source->m_resets == 1);
+    REQUIRE(numbering->m_resets == 1);
+    requireResetInOrder(sink->received());
+}
+
+TEST_CASE("reset stages of a pipeline that isn't running")
+{
+    auto source    = std::make_shared<CountingSource>();
+    auto numbering = std::make_shared<NumberingFilter>();
+    auto sink      = std::make_shared<RecordingSink>();
+    auto pipeline  = source | numbering | sink;
+
+    REQUIRE_FALSE(pipeline.resetStages(3, 1));
+    REQUIRE_FALSE(pipeline.resetStages(0, 0));
+
+    REQUIRE(pipeline.resetStages(0, 2));
+    REQUIRE(source->m_resets == 1);
+    REQUIRE(numbering->m_resets == 1);
+    REQUIRE(sink->received().empty());
+}
+
+} // namespace
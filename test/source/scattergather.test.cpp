@@ -0,0 +1,93 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/MultiFilter.h"
+#include "blpl/ScatterGather.h"
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+template <class In, class Out>
+auto makeHalver()
+{
+    auto filter = makeFunctorFilter<Partition<In, Out>>(
+        [](Partition<In, Out>&& part) {
+            for (size_t i = 0; i < part.in().size(); ++i)
+                part.out()[i] = static_cast<Out>(part.in()[i]) / 2;
+            return std::move(part);
+        });
+    return std::make_shared<decltype(filter)>(std::move(filter));
+}
+
+TEST_CASE("scatter partitions evenly along the granularity")
+{
+    ScatterFilter<int> scatter(3, 4);
+    std::vector<int> buffer(22);
+    const int* data = buffer.data();
+
+    auto parts = scatter.process(std::move(buffer));
+    REQUIRE(parts.size() == 3);
+
+    size_t offset = 0;
+    for (auto& part : parts) {
+        REQUIRE(part.offset() == offset);
+        REQUIRE(part.in().data() == data + offset);
+        offset += part.in().size();
+    }
+    REQUIRE(offset == 22);
+    // 6 blocks of 4 elements, the last one incomplete
+    REQUIRE(parts[0].in().size() == 8);
+    REQUIRE(parts[1].in().size() == 8);
+    REQUIRE(parts[2].in().size() == 6);
+
+    // more partitions than elements
+    auto small = ScatterFilter<int>(4).process(std::vector<int>(2));
+    REQUIRE(small.size() == 4);
+    REQUIRE(small[0].in().empty());
+    REQUIRE(small[3].in().size() == 1);
+}
+
+TEST_CASE("scatter multifilter gather without copies")
+{
+    ScatterFilter<int, float> scatter(3);
+    auto multifilter = makeHalver<int, float>() & makeHalver<int, float>() &
+                       makeHalver<int, float>();
+    GatherFilter<int, float> gather;
+
+    std::vector<int> in(100);
+    std::iota(in.begin(), in.end(), 0);
+
+    auto parts        = scatter.process(std::move(in));
+    const float* data = parts.front().out().data();
+    auto out          = gather.process(multifilter.process(std::move(parts)));
+
+    REQUIRE(out.size() == 100);
+    REQUIRE(out.data() == data);
+    for (size_t i = 0; i < out.size(); ++i)
+        REQUIRE(out[i] == static_cast<float>(i) / 2.f);
+}
+
+TEST_CASE("scatter in place writes into the input buffer")
+{
+    ScatterFilter<int> scatter(2, 1, true);
+    auto multifilter = makeHalver<int, int>() & makeHalver<int, int>();
+    GatherFilter<int> gather;
+
+    std::vector<int> in(10, 8);
+    const int* data = in.data();
+
+    auto out =
+        gather.process(multifilter.process(scatter.process(std::move(in))));
+    REQUIRE(out.size() == 10);
+    REQUIRE(out.data() == data);
+    for (int value : out)
+        REQUIRE(value == 4);
+}
+
+} // namespace
@@ -0,0 +1,189 @@
+#include "blpl/Filter.h"
+#include "blpl/StaticPipeline.h"
+
+#include <stdexcept>
+#include <string> // std::to_string, std::stoi
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class TestFilter0 final : public Filter<Generator, int>
+{
+public:
+    int processImpl(Generator&&) override
+    {
+        if (m_i < 100)
+            return m_i++;
+        return m_i;
+    }
+
+    void reset() override
+    {
+        m_i              = 0;
+        m_resetWasCalled = true;
+    }
+
+    int m_i               = 0;
+    bool m_resetWasCalled = false;
+};
+
+class TestFilter1 final : public Filter<int, float>
+{
+public:
+    float processImpl(int&& in) override
+    {
+        return static_cast<float>(in) / 2.f;
+    }
+};
+
+class TestFilter2 final : public Filter<float, std::string>
+{
+public:
+    std::string processImpl(float&& in) override
+    {
+        return std::to_string(in);
+    }
+};
+
+// filters don't need to inherit from Filter in a static pipeline
+struct NonVirtualFilter
+{
+    using inType  = std::string;
+    using outType = std::string;
+
+    std::string process(std::string&& in)
+    {
+        m_lastInput = in;
+        return std::move(in);
+    }
+    void reset()
+    {
+        m_lastInput.clear();
+    }
+
+    std::string m_lastInput;
+};
+
+TEST_CASE("static pipeline construction")
+{
+    StaticPipeline pipeline{TestFilter1(), TestFilter2(), NonVirtualFilter()};
+
+    static_assert(
+        std::is_same<decltype(pipeline)::inType, int>::value,
+        "wrong input type");
+    static_assert(
+        std::is_same<decltype(pipeline)::outType, std::string>::value,
+        "wrong output type");
+    REQUIRE(pipeline.length() == 3);
+    REQUIRE_FALSE(pipeline.isRunning());
+}
+
+TEST_CASE("static pipeline with generator")
+{
+    StaticPipeline pipeline{
+        TestFilter0(), TestFilter1(), TestFilter2(), NonVirtualFilter()};
+
+    // we want to spin the pipeline ourselfs
+    pipeline.outPipe().setWaitForSlowestFilter(true);
+
+    pipeline.start();
+    REQUIRE(pipeline.isRunning());
+    for (int i = 0; i < 101; ++i) {
+        pipeline.outPipe().blockingPop();
+    }
+    pipeline.stop();
+    REQUIRE_FALSE(pipeline.isRunning());
+
+    CHECK(pipeline.filter<0>().m_i == 100);
+    REQUIRE(!pipeline.filter<3>().m_lastInput.empty());
+    CHECK(std::stoi(pipeline.filter<3>().m_lastInput) == 50);
+}
+
+TEST_CASE("static pipeline with input")
+{
+    StaticPipeline pipeline{TestFilter1(), TestFilter2(), NonVirtualFilter()};
+
+    pipeline.outPipe().setWaitForSlowestFilter(true);
+
+    pipeline.start();
+    std::string lastOut;
+    for (int i = 0; i < 101; ++i) {
+        int pipeData = i;
+        pipeline.inPipe().push(std::move(pipeData));
+        lastOut = pipeline.outPipe().blockingPop();
+    }
+    pipeline.stop();
+
+    REQUIRE(!lastOut.empty());
+    CHECK(std::stoi(lastOut) == 50);
+}
+
+TEST_CASE("static pipeline drops elements whose filter throws")
+{
+    struct OddFilter
+    {
+        using inType  = int;
+        using outType = int;
+
+        int process(int&& in)
+        {
+            if (in % 2 != 0)
+                throw std::invalid_argument(std::to_string(in));
+            return in;
+        }
+        void reset() {}
+    };
+
+    StaticPipeline pipeline{OddFilter(), OddFilter()};
+    pipeline.inPipe().setWaitForSlowestFilter(true);
+    pipeline.outPipe().setWaitForSlowestFilter(true);
+    std::vector<FilterError> errors;
+    pipeline.setErrorSink(
+        [&errors](const FilterError& error) { errors.push_back(error); });
+
+    pipeline.start();
+    for (int i = 0; i < 4; ++i) {
+        int pipeData = i;
+        pipeline.inPipe().push(std::move(pipeData));
+        if (i % 2 == 0)
+            REQUIRE(pipeline.outPipe().blockingPop() == i);
+    }
+    pipeline.stop();
+
+    // the last element may have been dropped by stop() before it failed
+    REQUIRE(pipeline.errors(0) >= 1);
+    REQUIRE(pipeline.errors(1) == 0);
+    REQUIRE(errors.size() == pipeline.errors(0));
+    REQUIRE(errors[0].stage == 0);
+    REQUIRE(errors[0].sequence == 1);
+    REQUIRE(errors[0].what() == "1");
+}
+
+TEST_CASE("static pipeline reset")
+{
+    StaticPipeline pipeline{TestFilter0(), TestFilter1(), TestFilter2()};
+
+    pipeline.start();
+    for (int i = 0; i < 101; ++i) {
+        pipeline.outPipe().blockingPop();
+    }
+
+    pipeline.reset();
+    REQUIRE(pipeline.filter<0>().m_resetWasCalled);
+    REQUIRE(pipeline.isRunning());
+
+    pipeline.stop();
+    pipeline.reset();
+    REQUIRE(pipeline.filter<0>().m_i == 0);
+
+    // make sure that no thread was started up again
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(pipeline.filter<0>().m_i == 0);
+}
+
+} // namespace
@@ -0,0 +1,104 @@
+#include "blpl/MultiFilter.h"
+#include "blpl/Pipeline.h"
+#include "blpl/Tracer.h"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class TracedSource : public Filter<Generator, std::vector<int>>
+{
+public:
+    std::vector<int> processImpl(Generator&&) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ++m_i;
+        return {m_i, m_i + 1};
+    }
+
+    int m_i = 0;
+};
+
+class TracedSquare : public Filter<int, int>
+{
+public:
+    int processImpl(int&& in) override
+    {
+        return in * in;
+    }
+};
+
+size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos        = text.find(pattern, pos + pattern.size()))
+        ++count;
+    return count;
+}
+
+std::string chromeTrace()
+{
+    std::ostringstream out;
+    Tracer::writeChromeTrace(out);
+    return out.str();
+}
+
+TEST_CASE("trace scopes only record while tracing is enabled")
+{
+    Tracer::disable();
+    Tracer::clear();
+
+    { TraceScope scope("test", "disabled scope"); }
+
+    Tracer::enable();
+    { TraceScope scope("test", "enabled scope"); }
+    std::thread([] { TraceScope scope("test", "enabled scope"); }).join();
+    Tracer::disable();
+
+    std::string trace = chromeTrace();
+    CHECK(trace.find("disabled scope") == std::string::npos);
+    CHECK(countOccurrences(trace, R"("name":"enabled scope")") == 2);
+    CHECK(trace.find(R"("cat":"test","ph":"X")") != std::string::npos);
+
+    Tracer::clear();
+    CHECK(chromeTrace().find("enabled scope") == std::string::npos);
+}
+
+TEST_CASE("pipelines record filter events on named tracks")
+{
+    Tracer::clear();
+    Tracer::enable();
+
+    auto source   = std::make_shared<TracedSource>();
+    auto pipeline = source | (std::make_shared<TracedSquare>() &
+                              std::make_shared<TracedSquare>());
+
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pipeline.stop();
+    Tracer::disable();
+
+    std::string trace = chromeTrace();
+    CHECK(trace.find(R"("cat":"filter")") != std::string::npos);
+    CHECK(trace.find(R"("name":"(anonymous namespace)::TracedSource")") !=
+          std::string::npos);
+    CHECK(trace.find(R"("name":"(anonymous namespace)::TracedSquare")") !=
+          std::string::npos);
+    CHECK(trace.find(" lane 1\"") != std::string::npos);
+    CHECK(trace.find(R"("ph":"M")") != std::string::npos);
+    CHECK(trace.rfind("],\"displayTimeUnit\":\"ns\"}\n") != std::string::npos);
+
+    Tracer::clear();
+}
+
+} // namespace
@@ -0,0 +1,120 @@
+#include "blpl/FunctorFilter.h"
+#include "blpl/Pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace blpl;
+
+// anonymous namespace to prevent clashes between test files
+namespace {
+
+class HangingFilter : public Filter<int, double>
+{
+public:
+    double processImpl(int&& in) override
+    {
+        while (in < 0 && !m_released)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return in;
+    }
+
+    std::atomic<bool> m_released{false};
+};
+
+std::shared_ptr<FunctorFilter<int, int>> makeIdentity()
+{
+    return std::make_shared<FunctorFilter<int, int>>(
+        [](int&& in) { return in; });
+}
+
+TEST_CASE("watchdog reports a stalled filter once")
+{
+    auto hanging  = std::make_shared<HangingFilter>();
+    auto pipeline = makeIdentity() | hanging;
+
+    std::mutex mutex;
+    std::vector<StallReport> reports;
+    pipeline.startWatchdog(std::chrono::milliseconds(20),
+                           [&](const StallReport& report) {
+                               std::scoped_lock<std::mutex> lock(mutex);
+                               reports.push_back(report);
+                           });
+    pipeline.start();
+
+    // healthy elements pass without a report
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(pipeline.pushFor(int(i), std::chrono::seconds(1)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        REQUIRE(reports.empty());
+    }
+
+    // this one hangs in the second stage
+    REQUIRE(pipeline.pushFor(-1, std::chrono::seconds(1)));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::scoped_lock<std::mutex> lock(mutex);
+        if (!reports.empty())
+            break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    hanging->m_released = true;
+    pipeline.stopWatchdog();
+    pipeline.stop();
+
+    REQUIRE(reports.size() == 1);
+    const auto& report = reports.front();
+    REQUIRE(report.stage == 1);
+    REQUIRE(report.filter == hanging);
+    REQUIRE(report.filterName.find("HangingFilter") != std::string::npos);
+    REQUIRE(report.inType == "int");
+    REQUIRE(report.outType == "double");
+    REQUIRE(report.stalledFor >= std::chrono::milliseconds(20));
+    REQUIRE(report.pipes.size() == 3);
+
+    std::ostringstream out;
+    out << report;
+    REQUIRE(out.str().find("stalled for") != std::string::npos);
+}
+
+TEST_CASE("watchdog moves with the pipeline")
+{
+    auto hanging  = std::make_shared<HangingFilter>();
+    auto pipeline = makeIdentity() | hanging;
+
+    std::atomic<int> reports{0};
+    std::shared_ptr<AbstractFilter> stalled;
+    pipeline.startWatchdog(std::chrono::milliseconds(20),
+                           [&](const StallReport& report) {
+                               stalled = report.filter;
+                               ++reports;
+                           },
+                           std::chrono::milliseconds(1));
+    pipeline.start();
+
+    auto moved = std::move(pipeline);
+    REQUIRE(moved.pushFor(-1, std::chrono::seconds(1)));
+
+    // swapping filters races with the watchdog reading them
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (reports == 0 && std::chrono::steady_clock::now() < deadline)
+        REQUIRE(moved.replaceFilter(0, makeIdentity()));
+    hanging->m_released = true;
+    moved.stop();
+    moved.stopWatchdog();
+
+    REQUIRE(reports == 1);
+    REQUIRE(stalled == hanging);
+}
+
+} // namespace